@@ -14,12 +14,107 @@
 /* Number of exception types */
 #define NUM_EXCEPTIONS 3
 
+/* Number of ASL hash buckets (must be a power of 2) */
+#define ASL_HASH_BITS 5
+#define ASL_HASH_SIZE (1 << ASL_HASH_BITS)
+
+/* ASL hash bucket of a semaphore (Fibonacci hashing of its address) */
+#define ASL_HASH(semAdd) (((memaddr) (semAdd) * 2654435761U) >> (32 - ASL_HASH_BITS))
+
+/* Number of process priority levels (at most 32, 0 is the highest priority) */
+#define PRIO_LEVELS 8
+
+/* Priority assigned to the first process */
+#define PRIO_DEFAULT 4
+
+/* Ready Queue bitmap mask of the priority levels higher than prio */
+#define PRIO_HIGHER(prio) ((1U << (prio)) - 1)
+
+/* EDF: scale of the utilization of the real-time processes (1.0) */
+#define EDF_UTIL_SCALE 1024
+
+/* EDF: maximum total utilization of the real-time processes (about 94%, the rest is left to time-sharing) */
+#define EDF_UTIL_MAX (EDF_UTIL_SCALE - EDF_UTIL_SCALE / 16)
+
+/* EDF: maximum budget in microseconds (budget * EDF_UTIL_SCALE must fit in a word) */
+#define EDF_BUDGET_MAX (1U << 22)
+
+/* Scheduling policies, selected at build time through SCHED_POLICY (e.g. -DSCHED_POLICY=SCHED_MLFQ) */
+#define SCHED_PRIO 0	/* Fixed priority round-robin */
+#define SCHED_MLFQ 1	/* Multi-level feedback queue */
+#define SCHED_FAIR 2	/* Fair-share, ordered by virtual runtime */
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY SCHED_PRIO
+#endif
+
+#if SCHED_POLICY == SCHED_MLFQ
+/* Time slice of a priority level: lower levels run longer */
+#define TIME_SLICE(prio) (SCHED_TIME_SLICE * ((prio) + 1))
+
+/* Number of Pseudo-Clock ticks between two priority boosts */
+#define MLFQ_BOOST_TICKS 10
+#else
+#define TIME_SLICE(prio) SCHED_TIME_SLICE
+#endif
+
+#if SCHED_POLICY == SCHED_FAIR
+/* Virtual runtime charged for each microsecond of CPU time: higher priorities get a larger share */
+#define FAIR_WEIGHT(prio) ((prio) + 1)
+
+/* Maximum virtual runtime credit of a waking process w.r.t. the running ones */
+#define FAIR_SLEEPER_CREDIT SCHED_TIME_SLICE
+#endif
+
+/* Maximum number of armed kernel timer events: one for each process plus the kernel ones */
+#define TIMER_MAX (MAXPROC + 4)
+
+/* Interval Timer value when no timer event is armed */
+#define TIMER_IDLE 0xFFFFFFFF
+
+/* Timing wheel of the sleeping processes: WHEEL_LEVELS levels of WHEEL_SIZE slots, one Pseudo-Clock tick each */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_TICKS ((1U << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
 /* Word Size */
 #define WORD_SIZE 4
 
 /* SYS5 mnemonic constant */
 #define SPECTRAPVEC 5
 
+/* Additional nucleus-handled SYSCALL values */
+#define GETPRIORITY 9
+#define SETPRIORITY 10
+#define SETREALTIME 11
+#define TRYPASSEREN 12
+#define TIMEDPASSEREN 22
+#define SYSCALLBATCH 23
+#define SYSCALLSTATS 24
+#define DISKSTATS 25
+#define SUBMITIO 26
+#define FUTEXWAIT 27
+#define FUTEXWAKE 28
+
+/* Last nucleus-handled SYSCALL value (13 to SYSCALL_TOT are reserved by uARMconst.h) */
+#define SYSCALL_LAST FUTEXWAKE
+
+/* Resume the caller of a non-blocking SYSCALL without a full scheduler pass (0 to disable, e.g. for benchmarking) */
+#ifndef SYSCALL_FAST_RETURN
+#define SYSCALL_FAST_RETURN 1
+#endif
+
+/* SYSCALL values reserved to Kernel Mode processes */
+#define SYSCALL_PRIVILEGED(n) (((n) > 0 && (n) <= TRYPASSEREN) || ((n) > SYSCALL_TOT && (n) <= SUBMITIO))
+
+/* SYSCALL values handled by the nucleus for User Mode processes too (the slow path of the semaphore fast path) */
+#define SYSCALL_USER(n) ((n) == FUTEXWAIT || (n) == FUTEXWAKE)
+
+/* Longest timeout of a timed P in microseconds (timer events must stay within half the TOD range) */
+#define TIMEOUT_MAX 0x7FFFFFFF
+
 /* General purpose constants */
 #define EXTERN extern
 #define HIDDEN static
@@ -32,27 +127,49 @@
 #define PGMTRAP_EXCEPTION 1
 #define SYSBK_EXCEPTION 2
 
-/* Device Check Addresses */
-#define DEV_CHECK_ADDRESS_0 1
-#define DEV_CHECK_ADDRESS_1 2
-#define DEV_CHECK_ADDRESS_2 4
-#define DEV_CHECK_ADDRESS_3 8
-#define DEV_CHECK_ADDRESS_4 16
-#define DEV_CHECK_ADDRESS_5 32
-#define DEV_CHECK_ADDRESS_6 64
-#define DEV_CHECK_ADDRESS_7 128
+/* Serve every pending interrupt line and device in one interrupt entry (0: only the highest priority one) */
+#ifndef INT_DRAIN
+#define INT_DRAIN 1
+#endif
 
 /* Maximum number of devices per interrupt line */
 #define DEV_PER_INT 8
 
-/* Device Check Line */
-#define DEV_CHECK_LINE_0 0
-#define DEV_CHECK_LINE_1 1
-#define DEV_CHECK_LINE_2 2
-#define DEV_CHECK_LINE_3 3
-#define DEV_CHECK_LINE_4 4
-#define DEV_CHECK_LINE_5 5
-#define DEV_CHECK_LINE_6 6
-#define DEV_CHECK_LINE_7 7
+/* Device status: working on a command */
+#define DEV_S_BUSY 3
+
+/* Terminal driver: size of the ring buffers (a power of 2) and position of the character in a command */
+#define TERM_BUF_SIZE 128
+#define TERM_BUF_MASK (TERM_BUF_SIZE - 1)
+#define TERM_CHAR_SHIFT 8
+
+/* Terminal driver: end of line, completing a SYS13 */
+#define TERM_EOL '\n'
+
+/* Terminal driver: buffer the received characters for SYS13 (the receivers are then owned by the driver, so SYS8 cannot read them);
+   0 leaves SYS13 to be passed up, as in the original specification */
+#ifndef TERM_READ
+#define TERM_READ 1
+#endif
+
+/* Physical address the uARMconst.h memory map starts from: the nucleus runs unmapped, its image at RAM_BASE */
+#define KSEGOS_BASE_MAP RAM_BASE
+
+/* Disk driver: buffer cache frames, in the disk DMA area (at least one for each disk) */
+#define DISK_CACHE_START (OS_D_DMA_START)
+#define DISK_CACHE_FRAMES OS_D_DMA_PAGES
+
+/* Disk driver: fields of the geometry (DATA1) and of the commands */
+#define DISK_CYL_SHIFT 16
+#define DISK_HEAD_SHIFT 8
+#define DISK_GEOMETRY_MASK 0xFF
+#define DISK_SEEK_CYL_SHIFT 8
+#define DISK_BLK_HEAD_SHIFT 16
+#define DISK_BLK_SECT_SHIFT 8
+
+/* Disk driver: stages of a request */
+#define DISK_IDLE 0
+#define DISK_SEEK 1
+#define DISK_TRANSFER 2
 
 #endif
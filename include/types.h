@@ -5,22 +5,47 @@
 #include "base.h"
 #include "const.h"
 
+/* Kernel timer event type */
+typedef struct ktimer_t
+{
+	U32 t_expiry;								/**< Absolute expiry time (TOD) */
+	int t_index;								/**< Position in the timer queue, -1 if not armed */
+	void (*t_handler)(struct ktimer_t *t);		/**< Function called on expiry */
+	struct pcb_t *t_proc;						/**< Process the event refers to, if any */
+} ktimer_t;
+
 /* Process Control Block type */
 typedef struct pcb_t
 {
 	struct pcb_t
 	/* Process queue fields */
 		*p_next,			/**< Pointer to next entry */
+		*p_prev,			/**< Pointer to previous entry */
+		**p_queue,			/**< Tail-pointer of the queue the entry is linked in (NULL if none) */
 
 	/* Process tree fields */
 		*p_prnt,			/**< Pointer to parent */
 		*p_child,			/**< Pointer to first child */
-		*p_sib;				/**< Pointer to next sibling */
+		*p_sib,				/**< Pointer to next sibling */
+		*p_prevSib;			/**< Pointer to previous sibling */
 
 	/* Process management */
 	state_t p_s;								/**< Processor state */
 	S32 *p_semAdd;								/**< Pointer to semaphore on which process blocked */
+	struct semd_t *p_semd;						/**< Pointer to the descriptor of that semaphore */
 	cpu_t p_cpu_time;							/**< Process CPU time */
+	U32 p_priority;								/**< Priority level (0 is the highest) */
+	U32 p_boostEpoch;							/**< MLFQ: last priority boost seen by the process */
+	U32 p_vruntime;								/**< Fair-share: weighted CPU time consumed */
+	int p_heapIndex;							/**< Fair-share: position in the ready heap */
+	U32 p_rtPeriod;								/**< EDF: period (0 for time-sharing processes) */
+	U32 p_rtBudget;								/**< EDF: CPU budget per period */
+	U32 p_rtDeadline;							/**< EDF: deadline, relative to the release time */
+	U32 p_rtRelease;							/**< EDF: release time of the current period */
+	U32 p_rtLeft;								/**< EDF: budget left in the current period */
+	ktimer_t p_timer;							/**< Timer event of the process (e.g. real-time release) */
+	U32 p_wakeTick;								/**< Timing wheel: Pseudo-Clock tick at which the process wakes up */
+	struct pcb_t **p_wheelSlot;					/**< Timing wheel: slot of the sleeping process (NULL if not sleeping) */
 	U32 exceptionState[NUM_EXCEPTIONS];			/**< Exception State Vector */
 	state_t *p_stateOldArea[NUM_EXCEPTIONS];	/**< Old processor states, one for each exception type */
 	state_t *p_stateNewArea[NUM_EXCEPTIONS];	/**< New processor states, one for each exception type */
@@ -32,19 +57,104 @@ typedef struct pcb_t
 typedef struct semd_t
 {
 	struct semd_t *s_next; 		/**<  next element on the ASL */
+	struct semd_t *s_prev; 		/**<  previous element on the ASL */
 	int *s_semdAdd; 			/**<  pointer to the semaphore */
 	pcb_t *s_procQ; 			/**<  tail pointer to a process queue */
 } semd_t;
 
-/* Device semaphores */
+/* Asynchronous I/O control block (SYS26), in the memory of the submitting process */
+typedef struct
+{
+	U32 io_line;			/**< Interrupt line of the device */
+	U32 io_device;			/**< Device number */
+	U32 io_transm;			/**< Terminals only: TRUE for the transmitter, FALSE for the receiver */
+	U32 io_command;			/**< Command */
+	U32 io_data0;			/**< DATA0 of the command (disks, tapes and printers only) */
+	int *io_sem;			/**< Semaphore to V on completion (NULL if none) */
+	U32 io_done;			/**< Set to TRUE on completion */
+	U32 io_status;			/**< Device status on completion */
+} iocb_t;
+
+/* Asynchronous I/O request pending on a (sub)device */
+typedef struct
+{
+	iocb_t *a_iocb;			/**< Control block of the request (NULL if none) */
+	pcb_t *a_owner;			/**< Submitting process (NULL if it has been terminated) */
+} ioasync_t;
+
+/* Device descriptor */
+typedef struct
+{
+	int d_sem;				/**< Device semaphore (receiving semaphore for terminals) */
+	int d_semTransm;		/**< Transmitting semaphore (terminals only) */
+	ioasync_t d_async;		/**< Asynchronous request (receiving one for terminals) */
+	ioasync_t d_asyncTransm;	/**< Asynchronous transmitting request (terminals only) */
+	devreg_t *d_register;	/**< Device register */
+} device_t;
+
+/* Terminal driver ring buffer */
+typedef struct
+{
+	char r_data[TERM_BUF_SIZE];	/**< Buffered characters */
+	U32 r_head;					/**< Index of the first buffered character */
+	U32 r_count;				/**< Number of buffered characters */
+	int r_waiters;				/**< Key of the ASL queue of the waiting processes (its value is unused) */
+	int r_busy;					/**< TRUE while the device is working on the buffer */
+} termring_t;
+
+/* Disk buffer cache frame */
+typedef struct
+{
+	int f_disk;					/**< Disk of the cached block, -1 if the frame is empty */
+	U32 f_sector;				/**< Sector of the cached block */
+	U32 f_used;					/**< Time of the last use (LRU replacement) */
+	int f_busy;					/**< TRUE while the device is transferring the frame */
+	memaddr f_data;				/**< Physical address of the frame */
+} dcframe_t;
+
+/* Disk driver descriptor */
+typedef struct
+{
+	disk_data_t dk_geometry;	/**< Number of cylinders, heads and sectors (no cylinders if not installed) */
+	U32 dk_cylinder;			/**< Cylinder the head is on */
+	int dk_stage;				/**< Stage of the request in service (DISK_IDLE, DISK_SEEK, DISK_TRANSFER) */
+	int dk_waiters;				/**< Key of the ASL queue of the requests (its value is unused) */
+	pcb_t *dk_request;		/**< Process whose request is in service (NULL if it has been terminated) */
+	int dk_write;				/**< TRUE if the request in service is a DISK_PUT */
+	dcframe_t *dk_frame;		/**< Cache frame of the request in service */
+} disk_t;
+
+/* Disk driver counters */
+typedef struct
+{
+	U32 ds_hits;				/**< Blocks read from the cache */
+	U32 ds_misses;				/**< Blocks read from the device */
+	U32 ds_seeks;				/**< Seeks issued */
+} diskstat_t;
+
+/* Per-system call counters */
+typedef struct
+{
+	U32 st_calls;			/**< Number of calls */
+	U32 st_ticks;			/**< TOD ticks spent in the nucleus */
+} sysstat_t;
+
+/* System call dispatch table entry */
+typedef struct
+{
+	void (*sc_handler)();	/**< Handler (NULL if the system call is passed up) */
+	int sc_reschedule;		/**< TRUE if the handler may change the scheduling parameters of the caller */
+	sysstat_t sc_stat;		/**< Counters */
+} syscall_t;
+
+/* Operation descriptor of a batched system call (SYS23) */
 typedef struct
 {
-	int disk[DEV_PER_INT];
-	int tape[DEV_PER_INT];
-	int network[DEV_PER_INT];
-	int printer[DEV_PER_INT];
-	int terminalR[DEV_PER_INT];
-	int terminalT[DEV_PER_INT];
-} DeviceSemaphores;
+	U32 op_num;				/**< SYSCALL value */
+	U32 op_arg1;			/**< First argument */
+	U32 op_arg2;			/**< Second argument */
+	U32 op_arg3;			/**< Third argument */
+	U32 op_result;			/**< Return value of the operation */
+} sysop_t;
 #endif
 
@@ -5,13 +5,14 @@
 
 /* Internal function declarations */
 HIDDEN int isEmpty(semd_t *header);
+HIDDEN semd_t *getBucket(int *semAdd);
 HIDDEN void addToASL(semd_t *sem);
 HIDDEN semd_t *removeFromSemdFree(void);
 HIDDEN semd_t *findSemaphore(int *semAdd);
 HIDDEN void freeSemaphore(semd_t *sem);
 
-/* Pointer to the head of the Active Semaphore List (ASL) */
-HIDDEN semd_t *semd_h = NULL;
+/* Active Semaphore List (ASL): dummy headers of the hash buckets, each one a list sorted by semAdd */
+HIDDEN semd_t semd_h[ASL_HASH_SIZE];
 
 /* Pointer to the head of the unused semaphore descriptors list */
 HIDDEN semd_t *semdFree_h = NULL;
@@ -26,6 +27,16 @@ HIDDEN int isEmpty(semd_t *header)
 	return !header->s_next;
 }
 
+/**
+@brief Get the ASL bucket of a semaphore (Fibonacci hashing of its address).
+@param semAdd Address of the semaphore.
+@return The dummy header of the bucket.
+*/
+HIDDEN semd_t *getBucket(int *semAdd)
+{
+	return &semd_h[ASL_HASH(semAdd)];
+}
+
 /**
 @brief Add a semaphore to ASL.
 @param sem Pointer to the semaphore.
@@ -35,10 +46,12 @@ HIDDEN void addToASL(semd_t *sem)
 {
 	semd_t *it;
 
-	/* Iterate ASL until: the end of ASL is reached OR a semaphore with larger semAdd is found */
-	for (it = semd_h; it->s_next && it->s_next->s_semdAdd < sem->s_semdAdd; it = it->s_next);
+	/* Iterate the bucket until: its end is reached OR a semaphore with larger semAdd is found */
+	for (it = getBucket(sem->s_semdAdd); it->s_next && it->s_next->s_semdAdd < sem->s_semdAdd; it = it->s_next);
 
 	sem->s_next = it->s_next;
+	sem->s_prev = it;
+	if (it->s_next) it->s_next->s_prev = sem;
 	it->s_next = sem;
 }
 
@@ -56,7 +69,7 @@ HIDDEN semd_t *removeFromSemdFree(void)
 
 	output = semdFree_h->s_next;
 	semdFree_h->s_next = semdFree_h->s_next->s_next;
-	output->s_next = NULL;
+	output->s_next = output->s_prev = NULL;
 	output->s_procQ = mkEmptyProcQ();
 	output->s_semdAdd = NULL;
 
@@ -66,48 +79,46 @@ HIDDEN semd_t *removeFromSemdFree(void)
 /**
 @brief Search for a semaphore in ASL.
 @param semAdd Address of the semaphore.
-@return The pointer to the previous element, otherwise NULL.
+@return The pointer to the semaphore descriptor, otherwise NULL.
 */
 HIDDEN semd_t *findSemaphore(int *semAdd)
 {
 	semd_t *it;
 
-	/* Iterate ASL until: the end of ASL is reached OR a semaphore with >= semAdd is found */
-	for (it = semd_h; it->s_next && it->s_next->s_semdAdd < semAdd; it = it->s_next);
+	/* Iterate the bucket until: its end is reached OR a semaphore with >= semAdd is found */
+	for (it = getBucket(semAdd)->s_next; it && it->s_semdAdd < semAdd; it = it->s_next);
 
-	return (it->s_next && it->s_next->s_semdAdd == semAdd)? it : NULL;
+	return (it && it->s_semdAdd == semAdd)? it : NULL;
 }
 
 /**
 @brief Remove a semaphore from ASL. Add it to semdFree list.
-@param sem Pointer to the previous semaphore (or dummy node).
+@param sem Pointer to the semaphore descriptor.
 @return Void.
 */
 HIDDEN void freeSemaphore(semd_t *sem)
 {
-	semd_t *tmp;
-
-	tmp = sem->s_next->s_next;
+	/* Remove semAdd from ASL */
+	sem->s_prev->s_next = sem->s_next;
+	if (sem->s_next) sem->s_next->s_prev = sem->s_prev;
 
 	/* Add semAdd to semdFree */
-	sem->s_next->s_next = semdFree_h->s_next;
-	semdFree_h->s_next = sem->s_next;
-
-	/* Remove semAdd from ASL */
-	sem->s_next = tmp;
+	sem->s_next = semdFree_h->s_next;
+	sem->s_prev = NULL;
+	semdFree_h->s_next = sem;
 }
 
 /**
 @brief Initialize the semdFree list to contain all the elements of the
-array static semd_t semdTable[MAXPROC + 2].
-The size is increased by 2 because of 2 dummy headers (one for
-semdFree and one for ASL).
+array static semd_t semdTable[MAXPROC + 1].
+The size is increased by 1 because of the dummy header of semdFree;
+the ASL buckets have their own static dummy headers.
 This method will be only called once during data structure initialization.
 @return Void.
 */
 EXTERN void initASL(void)
 {
-	static semd_t semdTable[MAXPROC + 2];
+	static semd_t semdTable[MAXPROC + 1];
 	int i;
 
 	for (i = 0; i < MAXPROC; i++) semdTable[i].s_next = &semdTable[i + 1];
@@ -116,13 +127,13 @@ EXTERN void initASL(void)
 	/* semdTable[0] is the dummy header for semdFree */
 	semdFree_h = &semdTable[0];
 
-	/* semdTable[MAXPROC + 1] is the dummy header for ASL */
-	semdTable[MAXPROC + 1].s_next = NULL;
-	semd_h = &semdTable[MAXPROC + 1];
-
-	semd_h->s_next = NULL;
-	semd_h->s_semdAdd = NULL;
-	semd_h->s_procQ = mkEmptyProcQ();
+	/* Empty all the ASL buckets */
+	for (i = 0; i < ASL_HASH_SIZE; i++)
+	{
+		semd_h[i].s_next = semd_h[i].s_prev = NULL;
+		semd_h[i].s_semdAdd = NULL;
+		semd_h[i].s_procQ = mkEmptyProcQ();
+	}
 }
 
 /**
@@ -151,7 +162,8 @@ EXTERN int insertBlocked(int *semAdd, pcb_t *p)
 	if ((sem = findSemaphore(semAdd)))
 	{
 		p->p_semAdd = semAdd;
-	 	insertProcQ(&sem->s_next->s_procQ, p);
+		p->p_semd = sem;
+	 	insertProcQ(&sem->s_procQ, p);
 
 	 	output = FALSE;
 	}
@@ -162,6 +174,7 @@ EXTERN int insertBlocked(int *semAdd, pcb_t *p)
 		if ((sem = removeFromSemdFree()))
 		{
 			sem->s_semdAdd = p->p_semAdd = semAdd;
+			p->p_semd = sem;
 			insertProcQ(&sem->s_procQ, p);
 			addToASL(sem);
 
@@ -194,11 +207,12 @@ EXTERN pcb_t *removeBlocked(int *semAdd)
 	/* [Case 1] semAdd is in ASL */
 	if ((sem = findSemaphore(semAdd)))
 	{
-		output = removeProcQ(&sem->s_next->s_procQ);
+		output = removeProcQ(&sem->s_procQ);
 		output->p_semAdd = NULL;
+		output->p_semd = NULL;
 
 		/* If ProcQ is now empty, deallocate the semaphore */
-		if (emptyProcQ(sem->s_next->s_procQ)) freeSemaphore(sem);
+		if (emptyProcQ(sem->s_procQ)) freeSemaphore(sem);
 	}
 	/* [Case 2] semAdd is not in ASL */
 	else output = NULL;
@@ -212,28 +226,25 @@ associated with p’s semaphore (p->p_semAdd) on the ASL.
 If ProcBlk pointed to by p does not appear in the process
 queue associated with p’s semaphore, which is an error
 condition, return NULL; otherwise, return p.
+The semaphore descriptor is reached through p->p_semd, thus no ASL search is performed.
 */
 EXTERN pcb_t *outBlocked(pcb_t *p)
 {
-	pcb_t *output;
 	semd_t *sem;
 
-	/* Pre-conditions: p is not NULL */
-	if (!p || !p->p_semAdd) return NULL;
+	/* Pre-conditions: p is not NULL and is blocked on a semaphore */
+	if (!p || !(sem = p->p_semd)) return NULL;
 
-	/* [Case 1] semAdd is in ASL */
-	if ((sem = findSemaphore(p->p_semAdd)))
-	{
-		output = outProcQ(&sem->s_next->s_procQ, p);
-		output->p_semAdd = NULL;
+	/* p is not in the ProcQ of its semaphore */
+	if (!outProcQ(&sem->s_procQ, p)) return NULL;
 
-		/* If ProcQ is now empty, deallocate the semaphore */
-		if (emptyProcQ(sem->s_next->s_procQ)) freeSemaphore(sem);
-	}
-	/* [Case 2] semAdd is not in ASL */
-	else output = NULL;
+	p->p_semAdd = NULL;
+	p->p_semd = NULL;
 
-	return output;
+	/* If ProcQ is now empty, deallocate the semaphore */
+	if (emptyProcQ(sem->s_procQ)) freeSemaphore(sem);
+
+	return p;
 }
 
 /**
@@ -249,5 +260,42 @@ EXTERN pcb_t *headBlocked(int *semAdd)
 	/* Pre-conditions: semAdd is not NULL */
 	if (!semAdd) return NULL;
 
-	return ((sem = findSemaphore(semAdd)))? headProcQ(sem->s_next->s_procQ) : NULL;
+	return ((sem = findSemaphore(semAdd)))? headProcQ(sem->s_procQ) : NULL;
+}
+
+/**
+@brief Remove all the ProcBlks blocked on the semaphore semAdd and append
+them, in FIFO order, to the process queue whose tail-pointer is pointed to by tp.
+The semaphore is looked up once and its whole ProcQ is spliced at once;
+only the fields of the released ProcBlks are updated one by one.
+The semaphore descriptor is returned to the semdFree list.
+@param semAdd Pointer to the semaphore.
+@param tp Tail-pointer of the destination process queue.
+@return The number of released ProcBlks.
+*/
+EXTERN int removeAllBlocked(int *semAdd, pcb_t **tp)
+{
+	pcb_t *it;
+	semd_t *sem;
+	int output;
+
+	/* Pre-conditions: semAdd is not NULL and it is in ASL */
+	if (!semAdd || !(sem = findSemaphore(semAdd))) return 0;
+
+	/* Release the ProcBlks from the semaphore */
+	it = sem->s_procQ;
+	output = 0;
+	do
+	{
+		it->p_semAdd = NULL;
+		it->p_semd = NULL;
+		it = it->p_next;
+		output++;
+	} while (it != sem->s_procQ);
+
+	/* Move the whole ProcQ and deallocate the semaphore */
+	mergeProcQ(tp, &sem->s_procQ);
+	freeSemaphore(sem);
+
+	return output;
 }
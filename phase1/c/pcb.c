@@ -29,6 +29,17 @@ EXTERN void freePcb(pcb_t *p)
 	insertProcQ(&pcbFree_h, p);
 }
 
+/**
+@brief Insert all the elements of the process queue whose tail-pointer is pointed
+to by tp onto the pcbFree list (see mergeProcQ). The queue is left empty.
+@param tp Tail-pointer of a ProcQ.
+@return Void.
+*/
+EXTERN void freePcbQ(pcb_t **tp)
+{
+	mergeProcQ(&pcbFree_h, tp);
+}
+
 /**
 @brief Return NULL if the pcbFree list is empty.
 Otherwise, remove an element from the pcbFree list, provide
@@ -46,9 +57,20 @@ EXTERN pcb_t *allocPcb(void)
 	if ((output = removeProcQ(&pcbFree_h)))
 	{
 		int i;
-		output->p_next = output->p_prnt = output->p_child = output->p_sib = NULL;
+		output->p_next = output->p_prev = output->p_prnt = output->p_child = output->p_sib = output->p_prevSib = NULL;
+		output->p_queue = NULL;
 		output->p_semAdd = NULL;
+		output->p_semd = NULL;
 		output->p_isBlocked = FALSE;
+		output->p_priority = output->p_boostEpoch = output->p_vruntime = 0;
+		output->p_heapIndex = 0;
+		output->p_rtPeriod = output->p_rtBudget = output->p_rtDeadline = output->p_rtRelease = output->p_rtLeft = 0;
+		output->p_timer.t_expiry = 0;
+		output->p_timer.t_index = -1;
+		output->p_timer.t_handler = NULL;
+		output->p_timer.t_proc = output;
+		output->p_wakeTick = 0;
+		output->p_wheelSlot = NULL;
 		output->p_cpu_time = output->p_s.a1 = output->p_s.a2 = output->p_s.a3 = output->p_s.a4 =
 			output->p_s.v1 = output->p_s.v2 = output->p_s.v3 = output->p_s.v4 = output->p_s.v5 =
 			output->p_s.v6 = output->p_s.sl = output->p_s.fp = output->p_s.ip = output->p_s.sp =
@@ -110,17 +132,18 @@ EXTERN void insertProcQ(pcb_t **tp, pcb_t *p)
 
 	/* [Case 1] ProcQ is empty */
 	if (emptyProcQ(*tp))
-	{
-		*tp = p;
-		(*tp)->p_next = *tp;
-	}
+		p->p_next = p->p_prev = p;
 	/* [Case 2] ProcQ is not empty */
 	else
 	{
 		p->p_next = (*tp)->p_next;
+		p->p_prev = *tp;
+		(*tp)->p_next->p_prev = p;
 		(*tp)->p_next = p;
-		*tp = p;
 	}
+
+	p->p_queue = tp;
+	*tp = p;
 }
 
 /**
@@ -132,21 +155,10 @@ Update the process queue’s tail pointer if necessary.
 */
 EXTERN pcb_t *removeProcQ(pcb_t **tp)
 {
-	pcb_t *output;
-
 	/* Pre-conditions: ProcQ is not empty */
 	if (emptyProcQ(*tp)) return NULL;
 
-	output = (*tp)->p_next;
-
-	/* [Case 1] ProcQ has 1 ProcBlk */
-	if (hasOneProcBlk(*tp))
-		*tp = mkEmptyProcQ();
-	/* [Case 2] ProcQ has more than 1 ProcBlk */
-	else
-		(*tp)->p_next = (*tp)->p_next->p_next;
-
-	return output;
+	return outProcQ(tp, (*tp)->p_next);
 }
 
 /**
@@ -156,47 +168,30 @@ Update the process queue’s tail pointer if necessary.
 If the desired entry is not in the indicated queue (an error condition),
 return NULL; otherwise, return p.
 Note that p can point to any element of the process queue.
+Every ProcBlk records the tail-pointer of the queue it is linked in, so that
+the check is performed in constant time.
 */
 EXTERN pcb_t *outProcQ(pcb_t **tp, pcb_t *p)
 {
-	pcb_t *output, *it;
-
-	/* Pre-conditions: ProcQ is not empty and p is not NULL */
-	if (emptyProcQ(*tp) || !p) return NULL;
+	/* Pre-conditions: p is linked in this ProcQ */
+	if (!p || p->p_queue != tp) return NULL;
 
 	/* [Case 1] ProcQ has 1 ProcBlk */
-	if (hasOneProcBlk(*tp))
-	{
-		/* [Case 1.1] p is in ProcQ */
-		if (*tp == p)
-		{
-			output = p;
-			*tp = mkEmptyProcQ();
-		}
-		/* [Case 1.2] p is not in ProcQ */
-		else output = NULL;
-	}
+	if (hasOneProcBlk(*tp)) *tp = mkEmptyProcQ();
 	/* [Case 2] ProcQ has more than 1 ProcBlk */
 	else
 	{
-		/* Iterate PCB until: the end is reached OR the ProcBlk is found */
-		for (it = (*tp)->p_next; it != *tp && it->p_next != p; it = it->p_next);
-
-		/* [Case 2.1] p is in ProcQ */
-		if (it->p_next == p)
-		{
-			output = p;
-
-			/* If p is in the tail, update the tail-pointer */
-			if (it->p_next == *tp) *tp = it;
+		/* If p is in the tail, update the tail-pointer */
+		if (*tp == p) *tp = p->p_prev;
 
-			it->p_next = it->p_next->p_next;
-		}
-		/* [Case 2.2] p is not in ProcQ */
-		else output = NULL;
+		p->p_prev->p_next = p->p_next;
+		p->p_next->p_prev = p->p_prev;
 	}
 
-	return output;
+	p->p_next = p->p_prev = NULL;
+	p->p_queue = NULL;
+
+	return p;
 }
 
 /**
@@ -210,6 +205,42 @@ EXTERN pcb_t *headProcQ(pcb_t *tp)
 	return emptyProcQ(tp)? NULL : tp->p_next;
 }
 
+/**
+@brief Append the whole process queue whose tail-pointer is pointed to by tq
+to the process queue whose tail-pointer is pointed to by tp.
+The two rings are spliced in constant time; only the queue recorded by each
+appended ProcBlk is updated one by one.
+The order of both queues is preserved and the queue pointed to by tq is left empty.
+*/
+EXTERN void mergeProcQ(pcb_t **tp, pcb_t **tq)
+{
+	pcb_t *head, *it;
+
+	/* Pre-conditions: the appended ProcQ is not empty */
+	if (emptyProcQ(*tq)) return;
+
+	/* The appended ProcBlks now belong to the ProcQ */
+	it = *tq;
+	do
+	{
+		it->p_queue = tp;
+		it = it->p_next;
+	} while (it != *tq);
+
+	/* [Case 1] ProcQ is not empty: link the two rings together */
+	if (!emptyProcQ(*tp))
+	{
+		head = (*tp)->p_next;
+		(*tp)->p_next = (*tq)->p_next;
+		(*tq)->p_next->p_prev = *tp;
+		(*tq)->p_next = head;
+		head->p_prev = *tq;
+	}
+
+	*tp = *tq;
+	*tq = mkEmptyProcQ();
+}
+
 /**
 @brief Return TRUE if the ProcBlk pointed to by p has no children.
 Return FALSE otherwise.
@@ -228,7 +259,9 @@ EXTERN void insertChild(pcb_t *prnt, pcb_t *p)
 	if (!prnt || !p) return;
 
 	p->p_sib = prnt->p_child;
+	p->p_prevSib = NULL;
 	p->p_prnt = prnt;
+	if (prnt->p_child) prnt->p_child->p_prevSib = p;
 	prnt->p_child = p;
 }
 
@@ -239,15 +272,10 @@ Otherwise, return a pointer to this removed first child ProcBlk.
 */
 EXTERN pcb_t *removeChild(pcb_t *p)
 {
-	pcb_t *output;
-
 	/* Pre-conditions: p has children */
 	if (emptyChild(p)) return NULL;
 
-	output = p->p_child;
-	p->p_child = p->p_child->p_sib;
-
-	return output;
+	return outChild(p->p_child);
 }
 
 /**
@@ -258,21 +286,18 @@ child of its parent.
 */
 EXTERN pcb_t *outChild(pcb_t *p)
 {
-	pcb_t *it;
-
 	/* Pre-conditions: p is not NULL and has parent */
 	if (!p || !p->p_prnt) return NULL;
 
 	/* [Case 1] p is the first child */
-	if (p->p_prnt->p_child == p) p->p_prnt->p_child = p->p_sib;
+	if (!p->p_prevSib) p->p_prnt->p_child = p->p_sib;
 	/* [Case 2] p is not the first child */
-	else
-	{
-		/* Iterate the children until the child before p is reached */
-		for (it = p->p_prnt->p_child; it->p_sib != p; it = it->p_sib);
+	else p->p_prevSib->p_sib = p->p_sib;
 
-		it->p_sib = p->p_sib;
-	}
+	/* If p is not the last child, update the next sibling */
+	if (p->p_sib) p->p_sib->p_prevSib = p->p_prevSib;
+
+	p->p_prnt = p->p_sib = p->p_prevSib = NULL;
 
 	return p;
 }
@@ -10,4 +10,5 @@ EXTERN void initASL(void);
 EXTERN int insertBlocked(int *semAdd, pcb_t *p);
 EXTERN pcb_t *removeBlocked(int *semAdd);
 EXTERN pcb_t *outBlocked(pcb_t *p);
-EXTERN pcb_t *headBlocked(int *semAdd);
\ No newline at end of file
+EXTERN pcb_t *headBlocked(int *semAdd);
+EXTERN int removeAllBlocked(int *semAdd, pcb_t **tp);
\ No newline at end of file
@@ -9,4 +9,5 @@ EXTERN int emptyProcQ(pcb_t *tp);
 EXTERN void insertProcQ(pcb_t **tp, pcb_t *p);
 EXTERN pcb_t *removeProcQ(pcb_t **tp);
 EXTERN pcb_t *outProcQ(pcb_t **tp, pcb_t *p);
-EXTERN pcb_t *headProcQ(pcb_t *tp);
\ No newline at end of file
+EXTERN pcb_t *headProcQ(pcb_t *tp);
+EXTERN void mergeProcQ(pcb_t **tp, pcb_t **tq);
\ No newline at end of file
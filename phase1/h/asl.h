@@ -13,5 +13,6 @@ EXTERN int insertBlocked(int *semAdd, pcb_t *p);
 EXTERN pcb_t *removeBlocked(int *semAdd);
 EXTERN pcb_t *outBlocked(pcb_t *p);
 EXTERN pcb_t *headBlocked(int *semAdd);
+EXTERN int removeAllBlocked(int *semAdd, pcb_t **tp);
 
 #endif
@@ -9,6 +9,7 @@
 /* External function declarations */
 /* [1] List view functions */
 EXTERN void freePcb(pcb_t *p);
+EXTERN void freePcbQ(pcb_t **tp);
 EXTERN pcb_t *allocPcb(void);
 EXTERN void initPcbs(void);
 EXTERN pcb_t *mkEmptyProcQ(void);
@@ -17,6 +18,7 @@ EXTERN void insertProcQ(pcb_t **tp, pcb_t *p);
 EXTERN pcb_t *removeProcQ(pcb_t **tp);
 EXTERN pcb_t *outProcQ(pcb_t **tp, pcb_t *p);
 EXTERN pcb_t *headProcQ(pcb_t *tp);
+EXTERN void mergeProcQ(pcb_t **tp, pcb_t **tq);
 
 /* [2] Tree view functions */
 EXTERN int emptyChild(pcb_t *p);
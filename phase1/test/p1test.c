@@ -38,13 +38,17 @@
 #include "../h/asl.h"
 
 #define	MAXSEM	MAXPROC
+#define	HASHSEM	(8 * ASL_HASH_SIZE)
+#define	NCOLL	3
 
 char okbuf[2048];			/* sequence of progress messages */
 char errbuf[128];			/* contains reason for failing */
 char msgbuf[128];			/* nonrecoverable error message before shut down */
 int sem[MAXSEM];
 int onesem;
-pcb_t	*procp[MAXPROC], *p, *qa, *q, *firstproc, *lastproc, *midproc;
+int hashsem[HASHSEM];
+int *collsem[NCOLL];
+pcb_t	*procp[MAXPROC], *p, *qa, *qb, *q, *firstproc, *lastproc, *midproc;
 char *mp = okbuf;
 
 /* This function places the specified character string in okbuf and
@@ -63,7 +67,7 @@ void adderrbuf(char *strp) {
 }
 
 int main() {
-	int i;
+	int i, j;
 
 	initPcbs();
 	addokbuf("Initialized process control blocks   \n");
@@ -125,6 +129,20 @@ int main() {
 
 	if (outProcQ(&qa, procp[0]) != NULL)
 		adderrbuf("outProcQ(&qa, procp[0]) failed on nonexistent entry   ");
+
+	/* an entry of another queue (of the free list, too) is not in qa */
+	qb = mkEmptyProcQ();
+	insertProcQ(&qb, firstproc = allocPcb());
+	insertProcQ(&qb, midproc = allocPcb());
+	if (outProcQ(&qa, midproc) != NULL || outProcQ(&qa, firstproc) != NULL)
+		adderrbuf("outProcQ(&qa, q) removed an entry of another queue   ");
+	if (headProcQ(qb) != firstproc || outProcQ(&qb, midproc) != midproc ||
+		outProcQ(&qb, firstproc) != firstproc || !emptyProcQ(qb))
+		adderrbuf("outProcQ(&qa, q) corrupted another queue   ");
+	freePcb(midproc);
+	freePcb(firstproc);
+	if (outProcQ(&qa, firstproc) != NULL)
+		adderrbuf("outProcQ(&qa, q) removed an entry of the free list   ");
 	addokbuf("outProcQ() ok   \n");
 
 	/* Check if removeProc and insertProc remove in the correct order */
@@ -145,6 +163,68 @@ int main() {
 		adderrbuf("emptyProcQ(qa): unexpected FALSE   ");
 
 	addokbuf("insertProcQ(), removeProcQ() and emptyProcQ() ok   \n");
+
+	/* Check mergeProcQ: a 4-element queue followed by a 2-element one */
+	qa = mkEmptyProcQ();
+	qb = mkEmptyProcQ();
+	for (i = 0; i < 6; i++) {
+		if ((q = allocPcb()) == NULL)
+			adderrbuf("allocPcb(): unexpected NULL while merge   ");
+		switch (i) {
+			case 0:
+				firstproc = q;
+				break;
+			case 4:
+				midproc = q;
+				break;
+			case 5:
+				lastproc = q;
+				break;
+			default:
+				break;
+		}
+		insertProcQ((i < 4) ? &qa : &qb, q);
+	}
+	mergeProcQ(&qa, &qb);
+	if (!emptyProcQ(qb))
+		adderrbuf("mergeProcQ(&qa, &qb): appended queue not emptied   ");
+	if (headProcQ(qa) != firstproc)
+		adderrbuf("mergeProcQ(&qa, &qb): wrong head   ");
+	if (outProcQ(&qa, lastproc) != lastproc)
+		adderrbuf("mergeProcQ(&qa, &qb): wrong tail   ");
+	if (outProcQ(&qa, midproc) != midproc)
+		adderrbuf("mergeProcQ(&qa, &qb): appended entry not in queue   ");
+	insertProcQ(&qb, midproc);
+	insertProcQ(&qb, lastproc);
+	mergeProcQ(&qb, &qa);
+	if (removeProcQ(&qb) != midproc || removeProcQ(&qb) != lastproc || removeProcQ(&qb) != firstproc)
+		adderrbuf("mergeProcQ(&qb, &qa): wrong order   ");
+	freePcb(midproc);
+	freePcb(lastproc);
+	freePcb(firstproc);
+	mergeProcQ(&qb, &qa);
+	if (emptyProcQ(qb))
+		adderrbuf("mergeProcQ(&qb, &qa): empty queue not ignored   ");
+	while ((q = removeProcQ(&qb)) != NULL)
+		freePcb(q);
+	addokbuf("mergeProcQ() ok   \n");
+
+	/* Check freePcbQ: the 10 free entries, queued and freed at once, can all be allocated again */
+	qb = mkEmptyProcQ();
+	while ((q = allocPcb()) != NULL)
+		insertProcQ(&qb, q);
+	freePcbQ(&qb);
+	if (!emptyProcQ(qb))
+		adderrbuf("freePcbQ(&qb): queue not emptied   ");
+	for (i = 10; i < MAXPROC; i++) {
+		if ((procp[i] = allocPcb()) == NULL)
+			adderrbuf("freePcbQ(&qb): entries not returned to free list   ");
+	}
+	if (allocPcb() != NULL)
+		adderrbuf("freePcbQ(&qb): too many entries on free list   ");
+	for (i = 10; i < MAXPROC; i++)
+		freePcb(procp[i]);
+	addokbuf("freePcbQ() ok   \n");
 	addokbuf("process queues module ok      \n");
 
 	addokbuf("checking process trees...\n");
@@ -187,6 +267,26 @@ int main() {
 		adderrbuf("emptyChild(procp[0]): unexpected FALSE   ");
 
 	addokbuf("insertChild(), removeChild() and emptyChild() ok   \n");
+
+	/* Check outChild on the last and on a middle child: children are procp[5], [4], [3], [2], [1] */
+	for (i = 1; i < 6; i++)
+		insertChild(procp[0], procp[i]);
+	q = outChild(procp[1]);
+	if (q == NULL || q != procp[1])
+		adderrbuf("outChild(procp[1]) failed on last child   ");
+	q = outChild(procp[3]);
+	if (q == NULL || q != procp[3])
+		adderrbuf("outChild(procp[3]) failed on middle child   ");
+	if (outChild(procp[3]) != NULL)
+		adderrbuf("outChild(procp[3]) removed same child twice   ");
+
+	/* the siblings left must still be linked in order */
+	if (removeChild(procp[0]) != procp[5] || removeChild(procp[0]) != procp[4] ||
+		removeChild(procp[0]) != procp[2])
+		adderrbuf("removeChild(procp[0]): siblings not linked after outChild   ");
+	if (!emptyChild(procp[0]))
+		adderrbuf("emptyChild(procp[0]): unexpected FALSE after outChild   ");
+	addokbuf("outChild() on last and middle child ok   \n");
 	addokbuf("process tree module ok      \n");
 
 	for (i = 0; i < 10; i++)
@@ -256,6 +356,58 @@ int main() {
 	if (headBlocked(&sem[9]) != NULL)
 		adderrbuf("out/headBlocked: unexpected nonempty queue   ");
 	addokbuf("headBlocked() and outBlocked() ok   \n");
+
+	/* check semaphores colliding in one hash bucket, blocked out of address order */
+	addokbuf("hash collision test started   \n");
+	for (i = 0; i < 3; i++)
+		outBlocked(procp[i]);		/* procp[0..2] and procp[9] are now off the ASL */
+	for (i = 0, j = 0; i < HASHSEM && j < NCOLL; i++) {
+		if (ASL_HASH(&hashsem[i]) == ASL_HASH(&hashsem[0]))
+			collsem[j++] = &hashsem[i];
+	}
+	if (j < NCOLL)
+		adderrbuf("hash collision test: colliding semaphores not found   ");
+	if (insertBlocked(collsem[1], procp[0]) || insertBlocked(collsem[2], procp[1]) ||
+		insertBlocked(collsem[0], procp[2]) || insertBlocked(collsem[1], procp[9]))
+		adderrbuf("insertBlocked(collsem): unexpected TRUE   ");
+	if (headBlocked(collsem[0]) != procp[2] || headBlocked(collsem[1]) != procp[0] ||
+		headBlocked(collsem[2]) != procp[1])
+		adderrbuf("headBlocked(collsem): wrong process returned   ");
+	if (removeBlocked(collsem[1]) != procp[0] || removeBlocked(collsem[1]) != procp[9])
+		adderrbuf("removeBlocked(collsem[1]): removed wrong element   ");
+	if (headBlocked(collsem[1]) != NULL)
+		adderrbuf("removeBlocked(collsem[1]): semaphore left in bucket   ");
+	if (removeBlocked(collsem[0]) != procp[2] || removeBlocked(collsem[2]) != procp[1])
+		adderrbuf("removeBlocked(collsem): bucket corrupted   ");
+	if (headBlocked(collsem[0]) != NULL || headBlocked(collsem[2]) != NULL)
+		adderrbuf("removeBlocked(collsem): semaphore left in bucket   ");
+	addokbuf("hash collision test ok   \n");
+
+	/* check removeAllBlocked: procp[0..2] are blocked on onesem, procp[9] is already in qa */
+	addokbuf("removeAllBlocked() test started   \n");
+	qa = mkEmptyProcQ();
+	insertProcQ(&qa, procp[9]);
+	for (i = 0; i < 3; i++) {
+		if (insertBlocked(&onesem, procp[i]))
+			adderrbuf("insertBlocked(&onesem): unexpected TRUE   ");
+	}
+	if (removeAllBlocked(&onesem, &qa) != 3)
+		adderrbuf("removeAllBlocked(&onesem): wrong number of entries   ");
+	if (headBlocked(&onesem) != NULL)
+		adderrbuf("removeAllBlocked(&onesem): entries left on semaphore   ");
+	if (removeAllBlocked(&onesem, &qa) != 0)
+		adderrbuf("removeAllBlocked(&onesem): removed from nonexistent queue   ");
+	if (removeProcQ(&qa) != procp[9])
+		adderrbuf("removeAllBlocked(&onesem): destination queue overwritten   ");
+	for (i = 0; i < 3; i++) {
+		if ((q = removeProcQ(&qa)) != procp[i])
+			adderrbuf("removeAllBlocked(&onesem): wrong order   ");
+		if (outBlocked(q) != NULL)
+			adderrbuf("removeAllBlocked(&onesem): entry still blocked   ");
+	}
+	if (!emptyProcQ(qa))
+		adderrbuf("removeAllBlocked(&onesem): too many entries   ");
+	addokbuf("removeAllBlocked() ok   \n");
 	addokbuf("ASL module ok   \n");
 	addokbuf("So Long and Thanks for All the Fish\n");
 
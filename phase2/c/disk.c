@@ -0,0 +1,462 @@
+/**
+@file disk.c
+@note Disk driver: a process reads (SYS19) or writes (SYS18) a whole block, which goes through
+a buffer cache of FRAME_SIZE frames in the disk DMA area (LRU replacement, write-through).
+A read of a cached block never touches the device; the others are served in C-LOOK order.
+*/
+
+#include "../e/dependencies.e"
+
+/* Disk descriptors, one for each disk */
+HIDDEN disk_t Disks[DEV_PER_INT];
+
+/* Buffer cache frames */
+HIDDEN dcframe_t DiskCache[DISK_CACHE_FRAMES];
+
+/* Logical clock of the buffer cache, ticking at every use of a frame */
+HIDDEN U32 DiskCacheClock;
+
+/* Buffer cache and seek counters */
+HIDDEN diskstat_t DiskCacheStats;
+
+/**
+@brief Get the register of a disk.
+@param disk Disk number.
+@return Pointer to the disk register.
+*/
+HIDDEN dtpreg_t *diskRegister(int disk)
+{
+	return &Devices[EXT_IL_INDEX(INT_DISK)][disk].d_register->dtp;
+}
+
+/**
+@brief Tell whether a disk can be used by the driver: it is not busy, no interrupt is pending on it,
+and no asynchronous request and no SYS8 (a waiter, or a completion not reaped yet) are using it.
+@param disk Disk number.
+@return TRUE, if the disk is free; FALSE otherwise.
+*/
+HIDDEN int diskFree(int disk)
+{
+	device_t *device = &Devices[EXT_IL_INDEX(INT_DISK)][disk];
+
+	return (device->d_register->dtp.status != DEV_S_BUSY && !device->d_async.a_iocb && device->d_sem == 0 &&
+		!(*((U32 *) CDEV_BITMAP_ADDR(INT_DISK)) & (1 << disk)));
+}
+
+/**
+@brief Copy a block, by words if both the addresses are word aligned.
+@param destination Address of the destination.
+@param source Address of the source.
+@return Void.
+*/
+HIDDEN void diskCopy(memaddr destination, memaddr source)
+{
+	U32 i;
+
+	if (!((destination | source) & (WORD_SIZE - 1)))
+		for (i = 0; i < FRAME_SIZE; i += WORD_SIZE) *((U32 *) (destination + i)) = *((U32 *) (source + i));
+	else
+		for (i = 0; i < FRAME_SIZE; i++) *((U8 *) (destination + i)) = *((U8 *) (source + i));
+}
+
+/**
+@brief Translate a sector number into its position on a disk.
+The sectors are numbered along the heads of a cylinder first, then along the cylinders.
+@param descriptor Pointer to the disk descriptor.
+@param sector Sector number.
+@param cylinder Pointer to the cylinder (output).
+@param head Pointer to the head (output).
+@param sect Pointer to the sector within the track (output).
+@return Void.
+*/
+HIDDEN void diskLocate(disk_t *descriptor, U32 sector, U32 *cylinder, U32 *head, U32 *sect)
+{
+	U32 track = divide(sector, descriptor->dk_geometry.max_sect);
+
+	*sect = sector - track * descriptor->dk_geometry.max_sect;
+	*cylinder = divide(track, descriptor->dk_geometry.max_head);
+	*head = track - *cylinder * descriptor->dk_geometry.max_head;
+}
+
+/**
+@brief Look up a block in the buffer cache.
+@param disk Disk number.
+@param sector Sector number.
+@return Pointer to the frame holding the block; NULL if it is not cached.
+*/
+HIDDEN dcframe_t *diskLookup(int disk, U32 sector)
+{
+	int i;
+
+	for (i = 0; i < DISK_CACHE_FRAMES; i++)
+		if (DiskCache[i].f_disk == disk && DiskCache[i].f_sector == sector) return &DiskCache[i];
+
+	return NULL;
+}
+
+/**
+@brief Choose the frame for a block which is not cached: the least recently used one (an empty one,
+if any) among those the device is not transferring. There is always one, since at most one frame
+for each disk is being transferred.
+@return Pointer to the frame.
+*/
+HIDDEN dcframe_t *diskVictim()
+{
+	dcframe_t *victim = NULL;
+	int i;
+
+	for (i = 0; i < DISK_CACHE_FRAMES; i++)
+		if (!DiskCache[i].f_busy && (!victim || DiskCache[i].f_used < victim->f_used)) victim = &DiskCache[i];
+
+	return victim;
+}
+
+/**
+@brief Empty a frame, whose content is no more known.
+@param frame Pointer to the frame.
+@return Void.
+*/
+HIDDEN void diskDiscard(dcframe_t *frame)
+{
+	frame->f_disk = -1;
+	frame->f_used = 0;
+}
+
+/**
+@brief Wake up a process whose request is over.
+@param process Pointer to the ProcBlk of the process, already out of the request queue.
+@param result Result of the request.
+@return Void.
+*/
+HIDDEN void diskWake(pcb_t *process, int result)
+{
+	process->p_s.a1 = result;
+	SoftBlockCount--;
+	process->p_isBlocked = FALSE;
+	insertReady(process);
+}
+
+/**
+@brief Issue the command of the request in service: a seek, if the head is on another cylinder;
+otherwise the transfer of the block.
+@param disk Disk number.
+@return Void.
+*/
+HIDDEN void diskCommand(int disk)
+{
+	disk_t *descriptor = &Disks[disk];
+	dtpreg_t *deviceRegister = diskRegister(disk);
+	U32 cylinder, head, sect;
+
+	diskLocate(descriptor, descriptor->dk_frame->f_sector, &cylinder, &head, &sect);
+
+	/* [Case 1] Move the head onto the cylinder of the block */
+	if (cylinder != descriptor->dk_cylinder)
+	{
+		descriptor->dk_stage = DISK_SEEK;
+		DiskCacheStats.ds_seeks++;
+		deviceRegister->command = (cylinder << DISK_SEEK_CYL_SHIFT) | DEV_DISK_C_SEEKCYL;
+	}
+	/* [Case 2] Transfer the block between the cache frame and the disk */
+	else
+	{
+		descriptor->dk_stage = DISK_TRANSFER;
+		deviceRegister->data0 = descriptor->dk_frame->f_data;
+		deviceRegister->command = (head << DISK_BLK_HEAD_SHIFT) | (sect << DISK_BLK_SECT_SHIFT) |
+			(descriptor->dk_write? DEV_DISK_C_WRITEBLK : DEV_DISK_C_READBLK);
+	}
+}
+
+/**
+@brief Choose the next request of a disk in C-LOOK order: the nearest cylinder from the head
+onwards; past the highest requested cylinder, the head sweeps back to the lowest one.
+Requests for the same cylinder are served in arrival order.
+@param descriptor Pointer to the disk descriptor.
+@return Pointer to the ProcBlk of the process whose request comes next; NULL if there are no requests.
+*/
+HIDDEN pcb_t *diskNext(disk_t *descriptor)
+{
+	pcb_t *first, *process, *next;
+
+	if (!(first = next = headBlocked(&descriptor->dk_waiters))) return NULL;
+
+	/* The distance is taken modulo 2^32: the cylinders behind the head come after all the ones from it onwards */
+	for (process = first->p_next; process != first; process = process->p_next)
+		if (process->p_s.a3 - descriptor->dk_cylinder < next->p_s.a3 - descriptor->dk_cylinder) next = process;
+
+	return next;
+}
+
+/**
+@brief Start serving the next request of a disk. The reads of cached blocks are completed at once,
+until a request needs the device.
+@param disk Disk number.
+@return Void.
+*/
+HIDDEN void diskStart(int disk)
+{
+	disk_t *descriptor = &Disks[disk];
+	dcframe_t *frame;
+	pcb_t *process;
+
+	while ((process = diskNext(descriptor)))
+	{
+		frame = diskLookup(disk, process->p_s.a4);
+
+		/* [Case 1] Read of a cached block (e.g. filled while the request was waiting) */
+		if (process->p_s.a1 == DISK_GET && frame)
+		{
+			DiskCacheStats.ds_hits++;
+			frame->f_used = ++DiskCacheClock;
+			diskCopy(process->p_s.a2, frame->f_data);
+
+			outBlocked(process);
+			diskWake(process, DEV_S_READY);
+			continue;
+		}
+
+		/* [Case 2] The device is needed: the block takes a frame, if it has none */
+		if (process->p_s.a1 == DISK_GET) DiskCacheStats.ds_misses++;
+		if (!frame)
+		{
+			frame = diskVictim();
+			frame->f_disk = disk;
+			frame->f_sector = process->p_s.a4;
+		}
+		frame->f_used = ++DiskCacheClock;
+		frame->f_busy = TRUE;
+
+		/* The block to write goes through the cache */
+		if ((descriptor->dk_write = (process->p_s.a1 == DISK_PUT))) diskCopy(frame->f_data, process->p_s.a2);
+
+		/* The request stays in the queue while in service, so that its process can be terminated */
+		descriptor->dk_request = process;
+		descriptor->dk_frame = frame;
+		diskCommand(disk);
+		return;
+	}
+
+	/* No request left */
+	descriptor->dk_stage = DISK_IDLE;
+	descriptor->dk_request = NULL;
+}
+
+/**
+@brief Complete the request in service, waking up its process (if still alive).
+@param disk Disk number.
+@param result Result of the request: DEV_S_READY, or minus the device status.
+@return Void.
+*/
+HIDDEN void diskComplete(int disk, int result)
+{
+	disk_t *descriptor = &Disks[disk];
+	pcb_t *process = descriptor->dk_request;
+
+	descriptor->dk_frame->f_busy = FALSE;
+
+	/* On failure, the content of the frame is not the block on the disk */
+	if (result != DEV_S_READY) diskDiscard(descriptor->dk_frame);
+
+	if (process)
+	{
+		if (result == DEV_S_READY && !descriptor->dk_write) diskCopy(process->p_s.a2, descriptor->dk_frame->f_data);
+
+		if (!outBlocked(process)) PANIC(); /* Anomaly */
+		diskWake(process, result);
+	}
+}
+
+/**
+@brief Queue a request for a block, unless it is a read of a cached block.
+@param operation DISK_GET or DISK_PUT.
+@param buffer Address of the block in memory.
+@param disk Disk number.
+@param sector Sector number.
+@return DEV_S_READY, if the transfer succeeded; minus the device status in case of an error;
+-1 if the disk or the sector does not exist.
+*/
+HIDDEN int diskRequest(U32 operation, memaddr buffer, int disk, U32 sector)
+{
+	disk_t *descriptor;
+	dcframe_t *frame;
+	U32 cylinder, head, sect;
+
+	/* Pre-conditions: the disk is installed and the sector exists */
+	if (disk < 0 || disk >= DEV_PER_INT) return -1;
+	descriptor = &Disks[disk];
+	if (sector >= descriptor->dk_geometry.max_cyl * descriptor->dk_geometry.max_head * descriptor->dk_geometry.max_sect)
+		return -1;
+
+	/* [Case 1] Read of a cached block: the device is not touched (a frame being transferred is not ready yet) */
+	if (operation == DISK_GET && (frame = diskLookup(disk, sector)) && !frame->f_busy)
+	{
+		DiskCacheStats.ds_hits++;
+		frame->f_used = ++DiskCacheClock;
+		diskCopy(buffer, frame->f_data);
+
+		return DEV_S_READY;
+	}
+
+	/* [Case 2] Queue the request: it is tracked in the saved state of the caller (see diskStart and diskNext) */
+	diskLocate(descriptor, sector, &cylinder, &head, &sect);
+	CurrentProcess->p_s.a1 = operation;
+	CurrentProcess->p_s.a2 = buffer;
+	CurrentProcess->p_s.a3 = cylinder;
+	CurrentProcess->p_s.a4 = sector;
+	if (insertBlocked(&descriptor->dk_waiters, CurrentProcess)) PANIC(); /* Anomaly */
+	updateCPUTime();
+	SoftBlockCount++;
+	CurrentProcess->p_isBlocked = TRUE;
+	CurrentProcess = NULL;
+
+	/* Start the disk, if it is idle and free (otherwise the request is deferred, see diskResume) */
+	diskResume(disk);
+
+	/* Call the scheduler */
+	scheduler();
+
+	return 0; /* Not reached */
+}
+
+/**
+@brief (SYS19) Read a block from a disk.
+@param buffer Address where the block is stored (FRAME_SIZE bytes).
+@param disk Disk number.
+@param sector Sector number.
+@return DEV_S_READY, if the block has been read; minus the device status in case of an error;
+-1 if the disk or the sector does not exist.
+*/
+EXTERN int diskGet(memaddr buffer, int disk, U32 sector)
+{
+	return diskRequest(DISK_GET, buffer, disk, sector);
+}
+
+/**
+@brief (SYS18) Write a block on a disk (the caller waits for the device, the cache is written through).
+@param buffer Address of the block (FRAME_SIZE bytes).
+@param disk Disk number.
+@param sector Sector number.
+@return DEV_S_READY, if the block has been written; minus the device status in case of an error;
+-1 if the disk or the sector does not exist.
+*/
+EXTERN int diskPut(memaddr buffer, int disk, U32 sector)
+{
+	return diskRequest(DISK_PUT, buffer, disk, sector);
+}
+
+/**
+@brief Handle an interrupt of a disk, if the driver is using it.
+@param disk Disk number.
+@param status Status of the disk.
+@return TRUE, if the interrupt has been handled by the driver; FALSE otherwise.
+*/
+EXTERN int diskCompleted(int disk, U32 status)
+{
+	disk_t *descriptor = &Disks[disk];
+	U32 head, sect;
+
+	/* Pre-condition: the driver is serving a request on the disk */
+	if (descriptor->dk_stage == DISK_IDLE) return FALSE;
+
+	/* [Case 1] Seek done: transfer the block (this acknowledges the interrupt) */
+	if (status == DEV_S_READY && descriptor->dk_stage == DISK_SEEK)
+	{
+		diskLocate(descriptor, descriptor->dk_frame->f_sector, &descriptor->dk_cylinder, &head, &sect);
+		diskCommand(disk);
+
+		return TRUE;
+	}
+
+	/* [Case 2] Error: the position of the head is no more known (a cylinder out of range forces a seek) */
+	if (status != DEV_S_READY)
+	{
+		descriptor->dk_cylinder = descriptor->dk_geometry.max_cyl;
+		diskComplete(disk, -status);
+	}
+	/* [Case 3] Transfer done */
+	else diskComplete(disk, DEV_S_READY);
+
+	/* Start the next request, which acknowledges the interrupt; otherwise acknowledge it */
+	diskStart(disk);
+	if (descriptor->dk_stage == DISK_IDLE) diskRegister(disk)->command = DEV_C_ACK;
+
+	return TRUE;
+}
+
+/**
+@brief Start serving the requests of a disk, unless the driver is already serving one or the disk
+is still used by an asynchronous request or by SYS8 (the requests are then deferred until it is released).
+@param disk Disk number.
+@return Void.
+*/
+EXTERN void diskResume(int disk)
+{
+	if (Disks[disk].dk_stage == DISK_IDLE && diskFree(disk)) diskStart(disk);
+}
+
+/**
+@brief Forget a process whose request is in service, since it is being terminated:
+the transfer goes on, but its result is not delivered.
+@param process Pointer to the ProcBlk of the process.
+@return Void.
+*/
+EXTERN void diskCancel(pcb_t *process)
+{
+	int i;
+
+	for (i = 0; i < DEV_PER_INT; i++)
+		if (Disks[i].dk_request == process) Disks[i].dk_request = NULL;
+}
+
+/**
+@brief (SYS25) Copy the disk driver counters (buffer cache hits and misses, seeks) into a buffer.
+@param buffer Pointer to the counters.
+@return Void.
+*/
+EXTERN void diskStats(diskstat_t *buffer)
+{
+	*buffer = DiskCacheStats;
+}
+
+/**
+@brief Initialize the disk driver: read the geometry of the installed disks and empty the buffer cache.
+This method shall be called only once during data structure initialization.
+@return Void.
+*/
+EXTERN void initDisks()
+{
+	disk_t *descriptor;
+	dtpreg_t *deviceRegister;
+	int i;
+
+	for (i = 0; i < DISK_CACHE_FRAMES; i++)
+	{
+		diskDiscard(&DiskCache[i]);
+		DiskCache[i].f_busy = FALSE;
+		DiskCache[i].f_data = DISK_CACHE_START + i * FRAME_SIZE;
+	}
+	DiskCacheClock = DiskCacheStats.ds_hits = DiskCacheStats.ds_misses = DiskCacheStats.ds_seeks = 0;
+
+	for (i = 0; i < DEV_PER_INT; i++)
+	{
+		descriptor = &Disks[i];
+		deviceRegister = diskRegister(i);
+
+		/* A disk which is not installed has no sectors */
+		descriptor->dk_geometry.max_cyl = descriptor->dk_geometry.max_head = descriptor->dk_geometry.max_sect = 0;
+		if (deviceRegister->status != DEV_NOT_INSTALLED)
+		{
+			descriptor->dk_geometry.max_cyl = deviceRegister->data1 >> DISK_CYL_SHIFT;
+			descriptor->dk_geometry.max_head = (deviceRegister->data1 >> DISK_HEAD_SHIFT) & DISK_GEOMETRY_MASK;
+			descriptor->dk_geometry.max_sect = deviceRegister->data1 & DISK_GEOMETRY_MASK;
+		}
+
+		/* The position of the head is not known (a cylinder out of range forces a seek) */
+		descriptor->dk_cylinder = descriptor->dk_geometry.max_cyl;
+		descriptor->dk_stage = DISK_IDLE;
+		descriptor->dk_waiters = 0;
+		descriptor->dk_request = NULL;
+		descriptor->dk_frame = NULL;
+		descriptor->dk_write = FALSE;
+	}
+}
@@ -9,36 +9,99 @@ HIDDEN state_t *SYSBP_Old = 	(state_t *) SYSBK_OLDAREA;		/* System Call/Breakpoi
 HIDDEN state_t *TLB_Old = 		(state_t *) TLB_OLDAREA;		/* TLB Old Area */
 HIDDEN state_t *PGMTRAP_Old = 	(state_t *) PGMTRAP_OLDAREA;	/* Program Trap Old Area */
 
+/* System call wrappers: they take the arguments from the SYS/BP Old Area and store the result into the caller state */
+HIDDEN void sysCreateProcess();
+HIDDEN void sysVerhogen();
+HIDDEN void sysPasseren();
+HIDDEN void sysSpecTrapVec();
+HIDDEN void sysGetCPUTime();
+HIDDEN void sysWaitIO();
+HIDDEN void sysGetPriority();
+HIDDEN void sysSetPriority();
+HIDDEN void sysSetRealTime();
+HIDDEN void sysTryPasseren();
+HIDDEN void sysReadTerminal();
+HIDDEN void sysWriteTerminal();
+HIDDEN void sysDelay();
+HIDDEN void sysDiskPut();
+HIDDEN void sysDiskGet();
+HIDDEN void sysTimedPasseren();
+HIDDEN void sysSyscallBatch();
+HIDDEN void sysSyscallStats();
+HIDDEN void sysDiskStats();
+HIDDEN void sysSubmitIO();
+
+/* Kernel Mode system call handler, which serves the SYSCALL_USER values of User Mode processes too */
+HIDDEN void syscallKernelMode();
+
+/* System call dispatch table, indexed by SYSCALL value (no handler: passed up) */
+HIDDEN syscall_t SyscallTable[SYSCALL_LAST + 1] =
+{
+	{ NULL,				FALSE },	/* 0 */
+	{ sysCreateProcess,	FALSE },	/* CREATEPROCESS */
+	{ terminateProcess,	FALSE },	/* TERMINATEPROCESS */
+	{ sysVerhogen,		FALSE },	/* VERHOGEN */
+	{ sysPasseren,		FALSE },	/* PASSEREN */
+	{ sysSpecTrapVec,	FALSE },	/* SPECTRAPVEC */
+	{ sysGetCPUTime,	FALSE },	/* GETCPUTIME */
+	{ waitClock,		FALSE },	/* WAITCLOCK */
+	{ sysWaitIO,		FALSE },	/* WAITIO */
+	{ sysGetPriority,	FALSE },	/* GETPRIORITY */
+	{ sysSetPriority,	TRUE },		/* SETPRIORITY */
+	{ sysSetRealTime,	TRUE },		/* SETREALTIME */
+	{ sysTryPasseren,	FALSE },	/* TRYPASSEREN */
+#if TERM_READ
+	{ sysReadTerminal,	FALSE },	/* READTERMINAL */
+#else
+	{ NULL,				FALSE },	/* READTERMINAL */
+#endif
+	{ sysWriteTerminal,	FALSE },	/* WRITETERMINAL */
+	{ NULL,				FALSE },	/* VSEMVIRT */
+	{ NULL,				FALSE },	/* PSEMVIRT */
+	{ sysDelay,			FALSE },	/* DELAY */
+	{ sysDiskPut,		FALSE },	/* DISK_PUT */
+	{ sysDiskGet,		FALSE },	/* DISK_GET */
+	{ NULL,				FALSE },	/* WRITEPRINTER */
+	{ NULL,				FALSE },	/* TERMINATE */
+	{ sysTimedPasseren,	FALSE },	/* TIMEDPASSEREN */
+	{ sysSyscallBatch,	TRUE },		/* SYSCALLBATCH */
+	{ sysSyscallStats,	FALSE },	/* SYSCALLSTATS */
+	{ sysDiskStats,		FALSE },	/* DISKSTATS */
+	{ sysSubmitIO,		FALSE },	/* SUBMITIO */
+	{ sysPasseren,		FALSE },	/* FUTEXWAIT */
+	{ sysVerhogen,		FALSE }		/* FUTEXWAKE */
+};
+
+/* System call being handled, until the nucleus is left (NULL if none), and its starting time */
+HIDDEN syscall_t *SyscallPending = NULL;
+HIDDEN U32 SyscallStart;
+
 /**
 @brief Save current state in a new state.
+The 22 words of the state are moved in blocks of registers with multiple load/store
+instructions (ldm/stm), instead of one load and one store for each field.
 @param oldState Current state.
 @param newState New state.
 @return Void.
 */
 EXTERN void saveCurrentState(state_t *oldState, state_t *newState)
 {
-	newState->a1 = oldState->a1;
-	newState->a2 = oldState->a2;
-	newState->a3 = oldState->a3;
-	newState->a4 = oldState->a4;
-	newState->v1 = oldState->v1;
-	newState->v2 = oldState->v2;
-	newState->v3 = oldState->v3;
-	newState->v4 = oldState->v4;
-	newState->v5 = oldState->v5;
-	newState->v6 = oldState->v6;
-	newState->sl = oldState->sl;
-	newState->fp = oldState->fp;
-	newState->ip = oldState->ip;
-	newState->sp = oldState->sp;
-	newState->lr = oldState->lr;
-	newState->pc = oldState->pc;
-	newState->cpsr = oldState->cpsr;
-	newState->CP15_Control = oldState->CP15_Control;
-	newState->CP15_EntryHi = oldState->CP15_EntryHi;
-	newState->CP15_Cause = oldState->CP15_Cause;
-	newState->TOD_Hi = oldState->TOD_Hi;
-	newState->TOD_Low = oldState->TOD_Low;
+#ifdef __arm__
+	__asm__ __volatile__ (
+		"ldmia %0!, {r2-r7}\n\t"
+		"stmia %1!, {r2-r7}\n\t"
+		"ldmia %0!, {r2-r7}\n\t"
+		"stmia %1!, {r2-r7}\n\t"
+		"ldmia %0!, {r2-r7}\n\t"
+		"stmia %1!, {r2-r7}\n\t"
+		"ldmia %0!, {r2-r5}\n\t"
+		"stmia %1!, {r2-r5}"
+		: "+r" (oldState), "+r" (newState)
+		:
+		: "r2", "r3", "r4", "r5", "r6", "r7", "memory");
+#else
+	*newState = *oldState;
+#endif
 }
 
 /**
@@ -63,6 +126,7 @@ HIDDEN void checkSYS5(int exceptionType, state_t *exceptionOldArea)
 	{
 		/* Move current process Exception State Area into the processor Exception State Area */
 		saveCurrentState(exceptionOldArea, CurrentProcess->p_stateOldArea[exceptionType]);
+		chargeSyscall();
 
 		/* Load the processor state in order to start execution */
 		LDST(CurrentProcess->p_stateNewArea[exceptionType]);
@@ -76,18 +140,18 @@ HIDDEN void checkSYS5(int exceptionType, state_t *exceptionOldArea)
 HIDDEN void syscallUserMode()
 {
 	/* [Case 1] A privileged system call has been raised */
-	if (SYSBP_Old->a1 > 0 && SYSBP_Old->a1 < 9)
+	if (SYSCALL_PRIVILEGED(SYSBP_Old->a1))
 	{
-		/* Save SYS/BP Old Area into PgmTrap Old Area */
-		saveCurrentState(SYSBP_Old, PGMTRAP_Old);
+		/* Set program trap cause to RI (Reserved Instruction), in place: the SYS/BP Old Area acts as PgmTrap Old Area */
+		SYSBP_Old->CP15_Cause = CAUSE_EXCCODE_SET(SYSBP_Old->CP15_Cause, EXC_RESERVEDINSTR);
 
-		/* Set program trap cause to RI (Reserved Instruction) */
-		PGMTRAP_Old->CP15_Cause = CAUSE_EXCCODE_SET(PGMTRAP_Old->CP15_Cause, EXC_RESERVEDINSTR);
-
-		/* Call the trap handler in order to trigger the PgmTrap exception response */
-		pgmTrapHandler();
+		/* Trigger the PgmTrap exception response */
+		checkSYS5(PGMTRAP_EXCEPTION, SYSBP_Old);
 	}
-	/* [Case 2] A non privileged system call has been raised */
+	/* [Case 2] The slow path of a semaphore fast path: handled as in Kernel Mode */
+	else if (SYSCALL_USER(SYSBP_Old->a1))
+		syscallKernelMode();
+	/* [Case 3] A non privileged system call has been raised */
 	else
 		/* Distinguish whether SYS5 has been invoked or not */
 		checkSYS5(SYSBK_EXCEPTION, SYSBP_Old);
@@ -95,54 +159,50 @@ HIDDEN void syscallUserMode()
 
 /**
 @brief This function handles a system call request coming from a process running in Kernel Mode.
+The system call is looked up in the dispatch table; the values without a nucleus handler
+(e.g. the ones reserved to the support level) are passed up.
 @return Void.
 */
 HIDDEN void syscallKernelMode()
 {
-	/* Identify and handle the system call */
-	switch (SYSBP_Old->a1)
-	{
-		case CREATEPROCESS:
-			CurrentProcess->p_s.a1 = createProcess((state_t *) SYSBP_Old->a2);
-			break;
-
-		case TERMINATEPROCESS:
-			terminateProcess();
-			break;
-
-		case VERHOGEN:
-			verhogen((int *) SYSBP_Old->a2);
-			break;
-
-		case PASSEREN:
-			passeren((int *) SYSBP_Old->a2);
-			break;
+	syscall_t *entry;
 
-		case GETCPUTIME:
-			CurrentProcess->p_s.a1 = getCPUTime();
-			break;
+	/* [Case 1] Unknown system call: distinguish whether SYS5 has been invoked or not */
+	if (SYSBP_Old->a1 > SYSCALL_LAST) checkSYS5(SYSBK_EXCEPTION, SYSBP_Old);
 
-		case WAITCLOCK:
-			waitClock();
-			break;
+	/* Account the system call: its cost is charged when the nucleus is left */
+	entry = &SyscallTable[SYSBP_Old->a1];
+	entry->sc_stat.st_calls++;
+	SyscallPending = entry;
+	SyscallStart = getTODLO();
 
-		case WAITIO:
-			CurrentProcess->p_s.a1 = waitIO((int) SYSBP_Old->a2, (int) SYSBP_Old->a3, (int) SYSBP_Old->a4);
-			break;
+	/* [Case 2] Not handled by the nucleus: distinguish whether SYS5 has been invoked or not */
+	if (!entry->sc_handler) checkSYS5(SYSBK_EXCEPTION, SYSBP_Old);
 
-		case SPECTRAPVEC:
-			specTrapVec((int) SYSBP_Old->a2, (state_t *) SYSBP_Old->a3, (state_t *) SYSBP_Old->a4);
-			break;
+	/* [Case 3] Handle the system call: save SYS/BP Old Area state, where the result will be stored */
+	saveCurrentState(SYSBP_Old, &(CurrentProcess->p_s));
+	entry->sc_handler();
 
-		default:
-			/* Distinguish whether SYS5 has been invoked or not */
-			checkSYS5(SYSBK_EXCEPTION, SYSBP_Old);
-	}
+	/* The caller is still running and its scheduling parameters did not change: take the fast return path */
+	if (CurrentProcess && !entry->sc_reschedule) resumeProcess();
 
 	/* Call the scheduler */
 	scheduler();
 }
 
+/**
+@brief Charge the pending system call, if any, for the time spent in the nucleus.
+It shall be called whenever the nucleus is left after a system call (e.g. by the scheduler).
+@return Void.
+*/
+EXTERN void chargeSyscall()
+{
+	if (!SyscallPending) return;
+
+	SyscallPending->sc_stat.st_ticks += getTODLO() - SyscallStart;
+	SyscallPending = NULL;
+}
+
 /**
 @brief This function handles SYSCALL or Breakpoint exceptions, which occurs when a SYSCALL or BREAK assembler
 instruction is executed.
@@ -150,8 +210,9 @@ instruction is executed.
 */
 EXTERN void sysBpHandler()
 {
-	/* Save SYS/BP Old Area state */
-	saveCurrentState(SYSBP_Old, &(CurrentProcess->p_s));
+	/* The state is saved into the current process only if the nucleus handles the system call:
+	a passed up (or terminating) process never resumes from it */
+	if (!CurrentProcess) PANIC(); /* Anomaly */
 
 	/* Select handler accordingly to the exception type */
 	switch (CAUSE_EXCCODE_GET(SYSBP_Old->CP15_Cause))
@@ -178,8 +239,8 @@ EXTERN void sysBpHandler()
 */
 EXTERN void pgmTrapHandler()
 {
-	/* If a process is running, load Program Trap Old Area into the Current Process state */
-	(CurrentProcess)? saveCurrentState(PGMTRAP_Old, &(CurrentProcess->p_s)) : PANIC(); /* Anomaly */
+	/* A process must be running (its state is not saved: it is either passed up or terminated) */
+	if (!CurrentProcess) PANIC(); /* Anomaly */
 
 	/* Distinguish whether SYS5 has been invoked or not */
 	checkSYS5(PGMTRAP_EXCEPTION, PGMTRAP_Old);
@@ -191,8 +252,8 @@ EXTERN void pgmTrapHandler()
 */
 EXTERN void tlbHandler()
 {
-	/* If a process is running, load Program Trap Old Area into the Current Process state */
-	(CurrentProcess)? saveCurrentState(TLB_Old, &(CurrentProcess->p_s)) : PANIC(); /* Anomaly */
+	/* A process must be running (its state is not saved: it is either passed up or terminated) */
+	if (!CurrentProcess) PANIC(); /* Anomaly */
 
 	/* Distinguish whether SYS5 has been invoked or not */
 	checkSYS5(TLB_EXCEPTION, TLB_Old);
@@ -213,43 +274,106 @@ EXTERN int createProcess(state_t *state)
 	/* Load processor state into process state */
 	saveCurrentState(state, &(process->p_s));
 
+#if SCHED_POLICY == SCHED_MLFQ
+	/* The new process starts at the highest priority level */
+	process->p_priority = 0;
+#else
+	/* The new process inherits the priority of its parent */
+	process->p_priority = CurrentProcess->p_priority;
+#endif
+#if SCHED_POLICY == SCHED_FAIR
+	/* The new process starts from the virtual runtime of its parent */
+	process->p_vruntime = CurrentProcess->p_vruntime;
+#endif
+
 	/* Update process counter, process tree and process queue */
 	ProcessCount++;
 	insertChild(CurrentProcess, process);
-	insertProcQ(&ReadyQueue, process);
+	insertReady(process);
 
 	return 0; /* Success */
 }
 
 /**
-@brief Recursively terminates a process and its progeny.
-@param process Pointer to the Process Control Block.
+@brief Forget the asynchronous I/O requests of a process which is being terminated: the commands
+complete, but their control blocks are not touched anymore.
+@param process Pointer to the ProcBlk of the process.
 @return Void.
 */
-HIDDEN void _terminateProcess(pcb_t *process)
+HIDDEN void cancelIO(pcb_t *process)
 {
-	/* As long as the process has children, remove the first one and perform a recursive call */
-	while (!emptyChild(process)) _terminateProcess(removeChild(process));
+	int i, j;
+
+	for (i = 0; i < N_EXT_IL; i++)
+		for (j = 0; j < DEV_PER_INT; j++)
+		{
+			if (Devices[i][j].d_async.a_owner == process) Devices[i][j].d_async.a_owner = NULL;
+			if (Devices[i][j].d_asyncTransm.a_owner == process) Devices[i][j].d_asyncTransm.a_owner = NULL;
+		}
+}
 
-	/* If the process is blocked on a semaphore */
-	if (process->p_semAdd)
-	{
-		/* If it is the Pseudo-Clock semaphore or a non-device semaphore, and its value is negative */
-		if ((process->p_semAdd == &PseudoClock || !process->p_isBlocked) && (*process->p_semAdd) < 0)
-			(*process->p_semAdd)++; /* Update the value */
+/**
+@brief Terminates a process and its progeny.
+The process tree is visited in pre-order through the parent/child/sibling links,
+so that no recursion (and no stack proportional to the tree depth) is needed.
+The terminated ProcBlks are collected in a local ProcQ, which is given back to
+the pcbFree list at once.
+@param root Pointer to the Process Control Block at the root of the tree.
+@return Void.
+*/
+HIDDEN void _terminateProcess(pcb_t *root)
+{
+	pcb_t *process, *reclaimed;
 
-		/* Extract the process from the semaphore */
-		if (!outBlocked(process)) PANIC(); /* Anomaly */
+	reclaimed = mkEmptyProcQ();
 
-		/* In case of a device semaphore, update the Soft Block Count */
-		if (process->p_isBlocked) SoftBlockCount--;
+	for (process = root; process; )
+	{
+		/* [Case 1] The process is blocked on a semaphore */
+		if (process->p_semAdd)
+		{
+			/* If it is the Pseudo-Clock semaphore or a non-device semaphore, and its value is negative */
+			if ((process->p_semAdd == &PseudoClock || !process->p_isBlocked) && (*process->p_semAdd) < 0)
+				(*process->p_semAdd)++; /* Update the value */
+
+			/* Extract the process from the semaphore (a disk request in service is left without a requester) */
+			if (!outBlocked(process)) PANIC(); /* Anomaly */
+			diskCancel(process);
+
+			/* In case of a device semaphore or a timed P, update the Soft Block Count */
+			if (process->p_isBlocked || process->p_timer.t_index >= 0) SoftBlockCount--;
+		}
+		/* [Case 2] The process is sleeping: extract it from the timing wheel */
+		else if (process->p_wheelSlot) outSleeping(process);
+		/* [Case 3] The process is ready: extract it from the Ready Queue */
+		else outReady(process);
+
+		/* Cancel the pending timer event of the process, if any */
+		disarmTimer(&process->p_timer);
+
+		/* Its asynchronous I/O requests complete without notification */
+		cancelIO(process);
+
+		/* Give back the utilization of a real-time process */
+		if (process->p_rtPeriod) setRealTimeClass(process, 0, 0, 0);
+
+		/* Decrease the number of active processes */
+		ProcessCount--;
+
+		/* Collect the process block (the tree links are left untouched) */
+		insertProcQ(&reclaimed, process);
+
+		/* Move to the next process of the tree: first child, otherwise the first sibling found going up */
+		if (!emptyChild(process)) process = process->p_child;
+		else
+		{
+			while (process != root && !process->p_sib) process = process->p_prnt;
+			process = (process == root)? NULL : process->p_sib;
+		}
 	}
 
-	/* Decrease the number of active processes */
-	ProcessCount--;
-
-	/* Insert the process block into the pcbFree list */
- 	freePcb(process);
+	/* Insert all the process blocks into the pcbFree list */
+	freePcbQ(&reclaimed);
 }
 
 /**
@@ -264,7 +388,7 @@ EXTERN void terminateProcess()
 	/* Make the current process block no longer the child of its parent. */
 	outChild(CurrentProcess);
 
-	/* Call recursive function */
+	/* Terminate the whole process tree */
 	_terminateProcess(CurrentProcess);
 
 	/* Now there is no more a running process */
@@ -286,8 +410,15 @@ EXTERN void verhogen(int *semaddr)
 	/* If ASL is not empty */
 	if ((process = removeBlocked(semaddr)))
 	{
+		/* A timed P is satisfied before its timeout */
+		if (process->p_timer.t_index >= 0)
+		{
+			disarmTimer(&process->p_timer);
+			SoftBlockCount--;
+		}
+
 		/* Insert process into the ready queue */
-		insertProcQ(&ReadyQueue, process);
+		insertReady(process);
 		process->p_isBlocked = FALSE;
 	}
 }
@@ -305,6 +436,7 @@ EXTERN void passeren(int *semaddr)
 	{
 		/* Block process into the semaphore queue */
 		if (insertBlocked(semaddr, CurrentProcess)) PANIC(); /* Anomaly */
+		updateCPUTime();
 		CurrentProcess = NULL;
 
 		/* Call the scheduler */
@@ -325,6 +457,7 @@ HIDDEN void devPasseren(int *semaddr)
 	{
 		/* Block process into the semaphore queue */
 		if (insertBlocked(semaddr, CurrentProcess)) PANIC(); /* Anomaly */
+		updateCPUTime();
 		SoftBlockCount++;
 		CurrentProcess->p_isBlocked = TRUE;
 		CurrentProcess = NULL;
@@ -362,8 +495,7 @@ EXTERN void specTrapVec(int type, state_t *stateOld, state_t *stateNew)
 EXTERN U32 getCPUTime()
 {
 	/* Perform a last update of the CPU time */
-	CurrentProcess->p_cpu_time += getTODLO() - ProcessTOD;
-	ProcessTOD = getTODLO();
+	updateCPUTime();
 
 	return CurrentProcess->p_cpu_time;
 }
@@ -374,6 +506,8 @@ EXTERN U32 getCPUTime()
 */
 EXTERN void waitClock()
 {
+	/* The Pseudo-Clock ticks only while some process waits for it */
+	armPseudoClock();
 	devPasseren(&PseudoClock);
 }
 
@@ -386,30 +520,390 @@ EXTERN void waitClock()
 */
 EXTERN unsigned int waitIO(int interruptLine, int deviceNumber, int reading)
 {
+	device_t *device;
+
+	/* Pre-conditions: the device exists */
+	if (interruptLine < DEV_IL_START || interruptLine >= DEV_IL_START + N_EXT_IL) PANIC(); /* Anomaly */
+
+	/* Get the device descriptor */
+	device = &Devices[EXT_IL_INDEX(interruptLine)][deviceNumber];
+
+	/* [Case 1] The device is not the terminal */
+	if (interruptLine != INT_TERMINAL)
+	{
+		devPasseren(&device->d_sem);
+
+		/* The completion had already come: the disk driver may have deferred its requests until now */
+		if (interruptLine == INT_DISK) diskResume(deviceNumber);
+		return device->d_register->dtp.status;
+	}
+
+	/* [Case 2] The device is the terminal: distinguish between receiving and transmitting */
+	if (reading)
+	{
+		devPasseren(&device->d_sem);
+		return device->d_register->term.recv_status;
+	}
+
+	devPasseren(&device->d_semTransm);
+
+	/* The completion had already come: the terminal driver may have deferred its characters until now */
+	termResume(deviceNumber);
+	return device->d_register->term.transm_status;
+}
+
+/**
+@brief (SYS26) Submit a command to a device without waiting for it.
+On completion, the interrupt handler stores the device status into the control block, sets its
+done flag and performs a V on its semaphore: the process reaps the completion with a P (e.g. SYS4
+or SYS22) when it needs it. Until then, the request counts as soft blocked.
+@param iocb Pointer to the I/O control block.
+@return 0, if the command has been issued; -1 if the device does not exist, is not installed or is busy
+(with a command, an unserved completion or another asynchronous request).
+*/
+EXTERN int submitIO(iocb_t *iocb)
+{
+	device_t *device;
+	ioasync_t *async;
 	U32 status;
+	int transm;
+
+	/* Pre-conditions: the device exists */
+	if (iocb->io_line < DEV_IL_START || iocb->io_line >= DEV_IL_START + N_EXT_IL || iocb->io_device >= DEV_PER_INT) return -1;
+
+	device = &Devices[EXT_IL_INDEX(iocb->io_line)][iocb->io_device];
+	transm = (iocb->io_line == INT_TERMINAL && iocb->io_transm);
+	async = transm? &device->d_asyncTransm : &device->d_async;
+
+	/* Get the status of the (sub)device */
+	if (iocb->io_line != INT_TERMINAL) status = device->d_register->dtp.status;
+	else status = transm? device->d_register->term.transm_status : device->d_register->term.recv_status;
+	status &= DEV_TERM_STATUS;
 
-	switch (interruptLine)
+	/* Pre-conditions: the device is installed and idle, and no interrupt is pending on it */
+	if (async->a_iocb || status == DEV_NOT_INSTALLED || status == DEV_S_BUSY ||
+		(*((U32 *) CDEV_BITMAP_ADDR(iocb->io_line)) & (1 << iocb->io_device)))
+		return -1;
+
+	/* Record the request: the process goes on */
+	async->a_iocb = iocb;
+	async->a_owner = CurrentProcess;
+	iocb->io_done = FALSE;
+	SoftBlockCount++;
+
+	/* Issue the command */
+	if (iocb->io_line != INT_TERMINAL)
 	{
-		case INT_DISK:		devPasseren(&Semaphores.disk[deviceNumber]);		break;
-		case INT_TAPE:		devPasseren(&Semaphores.tape[deviceNumber]);		break;
-		case INT_UNUSED:	devPasseren(&Semaphores.network[deviceNumber]);		break;
-		case INT_PRINTER:	devPasseren(&Semaphores.printer[deviceNumber]);		break;
-		case INT_TERMINAL:	devPasseren((reading)? 	&Semaphores.terminalR[deviceNumber] :
-													&Semaphores.terminalT[deviceNumber]); break;
-		default: PANIC(); /* Anomaly */
+		device->d_register->dtp.data0 = iocb->io_data0;
+		device->d_register->dtp.command = iocb->io_command;
 	}
+	else if (transm) device->d_register->term.transm_command = iocb->io_command;
+	else device->d_register->term.recv_command = iocb->io_command;
 
-	/* [Case 1] The device is not the terminal */
-	if (interruptLine != INT_TERMINAL)
-		status = ((dtpreg_t *) DEV_REG_ADDR(interruptLine, deviceNumber))->status;
-	/* [Case 2] The device is the terminal */
-	else
+	return 0;
+}
+
+/**
+@brief (SYS9) Retrieve the priority level of the current process.
+@return Priority level of the current process.
+*/
+EXTERN U32 getPriority()
+{
+	return CurrentProcess->p_priority;
+}
+
+/**
+@brief (SYS10) Change the priority level of the current process.
+If a process with a higher priority is ready, it will preempt the current one.
+@param priority New priority level (0 is the highest).
+@return The previous priority level; -1 in case of an invalid priority level.
+*/
+EXTERN int setPriority(int priority)
+{
+	int output;
+
+	/* Pre-conditions: the priority level is valid */
+	if (priority < 0 || priority >= PRIO_LEVELS) return -1;
+
+	output = CurrentProcess->p_priority;
+	CurrentProcess->p_priority = priority;
+
+	return output;
+}
+
+/**
+@brief (SYS11) Make the current process a real-time one, scheduled by earliest deadline first,
+change its parameters or, if period is 0, make it time-sharing again.
+@param period Period in microseconds (0 to leave the real-time class).
+@param budget CPU budget per period in microseconds.
+@param deadline Deadline relative to the beginning of each period in microseconds (0 means equal to period).
+@return 0 in case of success; -1 if the parameters are invalid or the admission test fails.
+*/
+EXTERN int setRealTime(U32 period, U32 budget, U32 deadline)
+{
+	return setRealTimeClass(CurrentProcess, period, budget, deadline);
+}
+
+/**
+@brief (SYS17) Suspend the current process for a number of Pseudo-Clock ticks.
+@param ticks Number of Pseudo-Clock ticks (0 means no delay; longer delays are capped to WHEEL_MAX_TICKS).
+@return Void.
+*/
+EXTERN void delay(U32 ticks)
+{
+	/* Pre-conditions: the delay is not null */
+	if (!ticks) return;
+
+	/* Put the process to sleep on the timing wheel */
+	insertSleeping(CurrentProcess, (ticks > WHEEL_MAX_TICKS)? WHEEL_MAX_TICKS : ticks);
+	updateCPUTime();
+	CurrentProcess = NULL;
+
+	/* Call the scheduler */
+	scheduler();
+}
+
+/**
+@brief (SYS12) Performs a P operation on a semaphore only if it does not block.
+@param semaddr Semaphore address.
+@return 0, if the P has been performed; -1 if it would block (the semaphore is left untouched).
+*/
+EXTERN int tryPasseren(int *semaddr)
+{
+	/* [Case 1] The P would block */
+	if (*semaddr <= 0) return -1;
+
+	/* [Case 2] The P does not block */
+	(*semaddr)--;
+
+	return 0;
+}
+
+/**
+@brief Timer event handler: the timeout of a timed P has expired.
+The process is extracted from the semaphore, whose value is restored, and its P fails.
+@param t Pointer to the timer event of the process.
+@return Void.
+*/
+HIDDEN void passerenTimeout(ktimer_t *t)
+{
+	pcb_t *process = t->t_proc;
+
+	/* Give back the P on the semaphore */
+	(*process->p_semAdd)++;
+	if (!outBlocked(process)) PANIC(); /* Anomaly */
+	SoftBlockCount--;
+
+	/* The P fails */
+	process->p_s.a1 = -1;
+	insertReady(process);
+}
+
+/**
+@brief (SYS22) Performs a P operation on a semaphore, waiting at most for a timeout.
+While waiting, the process counts as soft blocked, since the timeout will wake it up.
+@param semaddr Semaphore address.
+@param timeout Timeout in microseconds (0 behaves like SYS12; capped to TIMEOUT_MAX).
+@return 0, if the P has been performed; -1 if the timeout expired first.
+*/
+EXTERN int timedPasseren(int *semaddr, U32 timeout)
+{
+	/* [Case 1] The P does not block, or the process cannot wait */
+	if (*semaddr > 0 || !timeout) return tryPasseren(semaddr);
+
+	/* [Case 2] Wait for a V or the timeout, whichever comes first */
+	CurrentProcess->p_s.a1 = 0;
+	CurrentProcess->p_timer.t_handler = passerenTimeout;
+	armTimer(&CurrentProcess->p_timer, getTODLO() + ((timeout > TIMEOUT_MAX)? TIMEOUT_MAX : timeout));
+	SoftBlockCount++;
+	passeren(semaddr);
+
+	return 0; /* Not reached: passeren() calls the scheduler */
+}
+
+/**
+@brief Perform one operation of a batched system call, if it cannot block.
+@param op Pointer to the operation descriptor.
+@return TRUE, if the operation has been performed; FALSE otherwise.
+*/
+HIDDEN int batchOperation(sysop_t *op)
+{
+	switch (op->op_num)
 	{
-		termreg_t *terminal = (termreg_t *) DEV_REG_ADDR(interruptLine, deviceNumber);
+		case CREATEPROCESS:
+			op->op_result = createProcess((state_t *) op->op_arg1);
+			break;
+
+		case VERHOGEN:
+			verhogen((int *) op->op_arg1);
+			op->op_result = 0;
+			break;
 
-		/* Distinguish between receiving and transmitting */
-		status = (reading)? terminal->recv_status : terminal->transm_status;
+		/* A P in a batch never blocks: the batch stops before it */
+		case PASSEREN:
+			if (tryPasseren((int *) op->op_arg1)) return FALSE;
+			op->op_result = 0;
+			break;
+
+		case GETCPUTIME:
+			op->op_result = getCPUTime();
+			break;
+
+		case GETPRIORITY:
+			op->op_result = getPriority();
+			break;
+
+		case SETPRIORITY:
+			op->op_result = setPriority((int) op->op_arg1);
+			break;
+
+		case TRYPASSEREN:
+			op->op_result = tryPasseren((int *) op->op_arg1);
+			break;
+
+		/* Any other operation may block, terminate or reschedule the process */
+		default:
+			return FALSE;
 	}
 
-	return status;
+	return TRUE;
+}
+
+/**
+@brief (SYS23) Perform a sequence of system calls with a single trap.
+The operations are performed in order, until the first one which would block
+(a P on a busy semaphore) or cannot be batched (e.g. SYS2, SYS7, SYS8); that
+one and the following are left to the caller. The results are stored into the
+descriptors. The scheduler runs once, at the end of the batch.
+@param ops Array of operation descriptors.
+@param count Number of operations.
+@return The number of operations performed.
+*/
+EXTERN U32 syscallBatch(sysop_t *ops, U32 count)
+{
+	U32 done;
+
+	for (done = 0; done < count && batchOperation(&ops[done]); done++);
+
+	return done;
+}
+
+/**
+@brief (SYS24) Copy the per-system call counters (calls and TOD ticks spent in the nucleus) into a buffer.
+@param buffer Array of counters, indexed by SYSCALL value.
+@param count Number of elements of the buffer.
+@return The number of counters copied.
+*/
+EXTERN U32 syscallStats(sysstat_t *buffer, U32 count)
+{
+	U32 i;
+
+	/* The counters of this call are updated up to now */
+	chargeSyscall();
+
+	for (i = 0; i < count && i <= SYSCALL_LAST; i++) buffer[i] = SyscallTable[i].sc_stat;
+
+	return i;
+}
+
+/* System call wrappers */
+
+HIDDEN void sysCreateProcess()
+{
+	CurrentProcess->p_s.a1 = createProcess((state_t *) SYSBP_Old->a2);
+}
+
+HIDDEN void sysVerhogen()
+{
+	verhogen((int *) SYSBP_Old->a2);
+}
+
+HIDDEN void sysPasseren()
+{
+	passeren((int *) SYSBP_Old->a2);
+}
+
+HIDDEN void sysSpecTrapVec()
+{
+	specTrapVec((int) SYSBP_Old->a2, (state_t *) SYSBP_Old->a3, (state_t *) SYSBP_Old->a4);
+}
+
+HIDDEN void sysGetCPUTime()
+{
+	CurrentProcess->p_s.a1 = getCPUTime();
+}
+
+HIDDEN void sysWaitIO()
+{
+	CurrentProcess->p_s.a1 = waitIO((int) SYSBP_Old->a2, (int) SYSBP_Old->a3, (int) SYSBP_Old->a4);
+}
+
+HIDDEN void sysGetPriority()
+{
+	CurrentProcess->p_s.a1 = getPriority();
+}
+
+HIDDEN void sysSetPriority()
+{
+	CurrentProcess->p_s.a1 = setPriority((int) SYSBP_Old->a2);
+}
+
+HIDDEN void sysSetRealTime()
+{
+	CurrentProcess->p_s.a1 = setRealTime(SYSBP_Old->a2, SYSBP_Old->a3, SYSBP_Old->a4);
+}
+
+HIDDEN void sysTryPasseren()
+{
+	CurrentProcess->p_s.a1 = tryPasseren((int *) SYSBP_Old->a2);
+}
+
+HIDDEN void sysReadTerminal()
+{
+	CurrentProcess->p_s.a1 = readTerminal((char *) SYSBP_Old->a2, SYSBP_Old->a3, (int) SYSBP_Old->a4);
+}
+
+HIDDEN void sysWriteTerminal()
+{
+	CurrentProcess->p_s.a1 = writeTerminal((char *) SYSBP_Old->a2, SYSBP_Old->a3, (int) SYSBP_Old->a4);
+}
+
+HIDDEN void sysDelay()
+{
+	delay(SYSBP_Old->a2);
+}
+
+HIDDEN void sysDiskPut()
+{
+	CurrentProcess->p_s.a1 = diskPut(SYSBP_Old->a2, (int) SYSBP_Old->a3, SYSBP_Old->a4);
+}
+
+HIDDEN void sysDiskGet()
+{
+	CurrentProcess->p_s.a1 = diskGet(SYSBP_Old->a2, (int) SYSBP_Old->a3, SYSBP_Old->a4);
+}
+
+HIDDEN void sysTimedPasseren()
+{
+	CurrentProcess->p_s.a1 = timedPasseren((int *) SYSBP_Old->a2, SYSBP_Old->a3);
+}
+
+HIDDEN void sysSyscallBatch()
+{
+	CurrentProcess->p_s.a1 = syscallBatch((sysop_t *) SYSBP_Old->a2, SYSBP_Old->a3);
+}
+
+HIDDEN void sysSyscallStats()
+{
+	CurrentProcess->p_s.a1 = syscallStats((sysstat_t *) SYSBP_Old->a2, SYSBP_Old->a3);
+}
+
+HIDDEN void sysDiskStats()
+{
+	diskStats((diskstat_t *) SYSBP_Old->a2);
+}
+
+HIDDEN void sysSubmitIO()
+{
+	CurrentProcess->p_s.a1 = submitIO((iocb_t *) SYSBP_Old->a2);
 }
@@ -0,0 +1,130 @@
+/**
+@file futex.c
+@note Semaphore fast path (futex-like) for the processes: the counter is updated
+without trapping into the nucleus, which is entered only to block on or wake up
+a semaphore with waiters.
+
+The protocol relies on an invariant kept by the nucleus SYS3/SYS4: a semaphore
+has processes blocked on it in the ASL if and only if its value is negative.
+The fast path never moves the value across zero, thus:
+(1) P on a positive value just decrements it, otherwise it performs FUTEXWAIT;
+(2) V on a non-negative value just increments it, otherwise it performs FUTEXWAKE.
+FUTEXWAIT and FUTEXWAKE are a whole P and V, as SYS4 and SYS3, which the nucleus
+also serves for User Mode processes (see SYSCALL_USER).
+The test and the update must not be split by a preemption. Masking interrupts
+is not allowed in User Mode, so each of them is a restartable sequence: a load,
+a test and a single committing store. If an interrupt is taken after the load
+and before the store, the interrupt handler moves the process back to the load
+(see futexRestart), so the counter is read again once the process is resumed.
+*/
+
+#include "../e/dependencies.e"
+
+#ifdef __arm__
+
+/* Turn a numeric constant into an assembler immediate */
+#define FUTEX_STR(x) #x
+#define FUTEX_IMM(x) "#" FUTEX_STR(x)
+
+/* Committing stores of the restartable sequences (labels of the code below) */
+extern void fastPasserenCommit();
+extern void fastVerhogenCommit();
+
+/*
+fastPasseren: the value is taken only if it is positive (value - 1 >= 0), otherwise FUTEXWAIT.
+fastVerhogen: the value is released only if it is non-negative (value + 1 > 0), otherwise FUTEXWAKE.
+The system call is a tail call to SYSCALL, with the semaphore address as its first argument.
+*/
+__asm__ (
+	"\t.text\n"
+	"\t.align 2\n"
+	"\t.global fastPasseren\n"
+	"\t.global fastPasserenCommit\n"
+	"\t.type fastPasseren, %function\n"
+	"fastPasseren:\n"
+	"\tldr r1, [r0]\n"
+	"\tsubs r1, r1, #1\n"
+	"\tblt 1f\n"
+	"fastPasserenCommit:\n"
+	"\tstr r1, [r0]\n"
+	"\tbx lr\n"
+	"1:\tmov r1, r0\n"
+	"\tmov r0, " FUTEX_IMM(FUTEXWAIT) "\n"
+	"\tmov r2, #0\n"
+	"\tmov r3, #0\n"
+	"\tb SYSCALL\n"
+	"\t.size fastPasseren, .-fastPasseren\n"
+	"\t.global fastVerhogen\n"
+	"\t.global fastVerhogenCommit\n"
+	"\t.type fastVerhogen, %function\n"
+	"fastVerhogen:\n"
+	"\tldr r1, [r0]\n"
+	"\tadds r1, r1, #1\n"
+	"\tble 1f\n"
+	"fastVerhogenCommit:\n"
+	"\tstr r1, [r0]\n"
+	"\tbx lr\n"
+	"1:\tmov r1, r0\n"
+	"\tmov r0, " FUTEX_IMM(FUTEXWAKE) "\n"
+	"\tmov r2, #0\n"
+	"\tmov r3, #0\n"
+	"\tb SYSCALL\n"
+	"\t.size fastVerhogen, .-fastVerhogen\n"
+);
+
+/**
+@brief Move an interrupted process back to the beginning of a restartable sequence,
+if it has loaded the counter but it has not stored it yet.
+@param state Processor state of the interrupted process.
+@param begin Address of the first instruction of the sequence.
+@param commit Address of the committing store.
+@return Void.
+*/
+HIDDEN void restartSequence(state_t *state, memaddr begin, memaddr commit)
+{
+	if (state->pc > begin && state->pc <= commit) state->pc = begin;
+}
+
+/**
+@brief Restart the fast path P or V interrupted by the given state, if any.
+@param state Processor state of the interrupted process (its pc is the next instruction to execute).
+@return Void.
+*/
+EXTERN void futexRestart(state_t *state)
+{
+	restartSequence(state, (memaddr) fastPasseren, (memaddr) fastPasserenCommit);
+	restartSequence(state, (memaddr) fastVerhogen, (memaddr) fastVerhogenCommit);
+}
+
+#else
+
+/**
+@brief Performs a P operation on a semaphore (no fast path on this architecture).
+@param semaddr Semaphore address.
+@return Void.
+*/
+EXTERN void fastPasseren(int *semaddr)
+{
+	SYSCALL(FUTEXWAIT, (int) semaddr, 0, 0);
+}
+
+/**
+@brief Performs a V operation on a semaphore (no fast path on this architecture).
+@param semaddr Semaphore address.
+@return Void.
+*/
+EXTERN void fastVerhogen(int *semaddr)
+{
+	SYSCALL(FUTEXWAKE, (int) semaddr, 0, 0);
+}
+
+/**
+@brief Restart the fast path P or V interrupted by the given state (none on this architecture).
+@param state Processor state of the interrupted process.
+@return Void.
+*/
+EXTERN void futexRestart(state_t *state)
+{
+}
+
+#endif
@@ -8,14 +8,13 @@
 EXTERN void test ();
 
 /* Global variables declarations */
-pcb_t *ReadyQueue;						/**< Process ready queue */
+pcb_t *ReadyQueue[PRIO_LEVELS];			/**< Process ready queues, one for each priority level */
+U32 ReadyBitmap;						/**< Bitmap of the non-empty ready queues */
 pcb_t *CurrentProcess;					/**< Pointer to the executing PCB */
 U32 ProcessCount;						/**< Process counter */
 U32 SoftBlockCount;						/**< Blocked process counter */
 U32 ProcessTOD;							/**< Process start time */
-U32 TimerTick;							/**< Tick timer */
-U32 StartTimerTick;						/**< Pseudo-clock tick start time */
-DeviceSemaphores Semaphores;			/**< Device semaphores per line */
+device_t Devices[N_EXT_IL][DEV_PER_INT];	/**< Device descriptors, one for each line and device */
 int PseudoClock;						/**< Pseudo-clock semaphore */
 
 /**
@@ -53,7 +52,7 @@ HIDDEN void populateNewArea(memaddr oldArea, memaddr handler)
 int main()
 {
 	pcb_t *init;
-	int i;
+	int i, j;
 
 	/* Populate the 4 processor state areas into the ROM Reserved Frame */
 	populateNewArea(SYSBK_NEWAREA,		(memaddr) sysBpHandler);	/* SYS/BP Exception Handling */
@@ -66,14 +65,20 @@ int main()
 	initASL();
 
 	/* Initialize global variables */
-	ReadyQueue = mkEmptyProcQ();
+	for (i = 0; i < PRIO_LEVELS; i++) ReadyQueue[i] = mkEmptyProcQ();
+	ReadyBitmap = 0;
 	CurrentProcess = NULL;
-	ProcessCount = SoftBlockCount = TimerTick = PseudoClock = 0;
-
-	/* Initialize device semaphores */
-	for (i = 0; i < DEV_PER_INT; i++)
-		Semaphores.disk[i] = Semaphores.tape[i] = Semaphores.network[i] =
-		Semaphores.printer[i] = Semaphores.terminalR[i] = Semaphores.terminalT[i] = 0;
+	ProcessCount = SoftBlockCount = PseudoClock = 0;
+
+	/* Initialize device descriptors */
+	for (i = 0; i < N_EXT_IL; i++)
+		for (j = 0; j < DEV_PER_INT; j++)
+		{
+			Devices[i][j].d_sem = Devices[i][j].d_semTransm = 0;
+			Devices[i][j].d_async.a_iocb = Devices[i][j].d_asyncTransm.a_iocb = NULL;
+			Devices[i][j].d_async.a_owner = Devices[i][j].d_asyncTransm.a_owner = NULL;
+			Devices[i][j].d_register = (devreg_t *) DEV_REG_ADDR(DEV_IL_START + i, j);
+		}
 
 	/* Initialize init method */
 	if (!(init = allocPcb())) PANIC(); /* Anomaly */
@@ -93,14 +98,21 @@ int main()
 	/* Initialize Program Counter with the Test process */
 	init->p_s.pc = (memaddr) test;
 
-	/* Insert init in ProcQ */
-	insertProcQ(&ReadyQueue, init);
+	/* Insert init in the Ready Queue */
+	init->p_priority = PRIO_DEFAULT;
+	insertReady(init);
 
 	/* Increment Process Count */
 	ProcessCount++;
 
-	/* Start the timer tick */
-	StartTimerTick = getTODLO();
+	/* Initialize the timer events and align the Pseudo-Clock ticks to now */
+	initTimers();
+
+	/* Initialize the terminal driver */
+	initTerminals();
+
+	/* Initialize the disk driver */
+	initDisks();
 
 	/* Call the scheduler */
 	scheduler();
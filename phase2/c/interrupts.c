@@ -8,23 +8,6 @@
 /* Interrupt Old Area */
 HIDDEN state_t *InterruptOldArea = (state_t *) INT_OLDAREA;
 
-/**
-@brief Get the highest priority device affected by a pending interrupt.
-@param bitmap The device bitmap.
-@return Index of the device.
-*/
-HIDDEN int getDevice(int bitmap)
-{
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_0)) return DEV_CHECK_LINE_0;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_1)) return DEV_CHECK_LINE_1;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_2)) return DEV_CHECK_LINE_2;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_3)) return DEV_CHECK_LINE_3;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_4)) return DEV_CHECK_LINE_4;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_5)) return DEV_CHECK_LINE_5;
-	if (bitmap == (bitmap | DEV_CHECK_ADDRESS_6)) return DEV_CHECK_LINE_6;
-	return DEV_CHECK_LINE_7;
-}
-
 /**
 @brief Performs a V on the given device semaphore.
 Thus, decrements the Soft Block Count and set the p_isBlocked flag as FALSE.
@@ -43,7 +26,7 @@ HIDDEN void intVerhogen(int *semaddr, int status)
 	if ((process = removeBlocked(semaddr)))
 	{
 		/* Add the process into the Ready Queue */
-		insertProcQ(&ReadyQueue, process);
+		insertReady(process);
 		SoftBlockCount--;
 		process->p_isBlocked = FALSE;
 		process->p_s.a1 = status;
@@ -51,148 +34,198 @@ HIDDEN void intVerhogen(int *semaddr, int status)
 }
 
 /**
-@brief Acknowledge a pending interrupt on the Timer Click.
+@brief Complete the asynchronous request pending on a (sub)device: store the status into its
+control block and perform a V on its semaphore (unless the submitting process has been terminated).
+@param async Pointer to the pending request.
+@param status Device status.
 @return Void.
 */
-HIDDEN void intTimer()
+HIDDEN void intComplete(ioasync_t *async, U32 status)
 {
-	pcb_t *process;
-
-	/* Update elapsed time */
-	TimerTick += getTODLO() - StartTimerTick;
-	StartTimerTick = getTODLO();
-
-	/* [Case 1] The Time Slice for the current process did not run out */
-	if (TimerTick >= SCHED_PSEUDO_CLOCK)
-	{
-		/* [Case 1.1] There is at least one blocked process */
-		if (PseudoClock < 0)
-		{
-			/* Unleash all of them */
-			for (; PseudoClock < 0; PseudoClock++)
-			{
-				/* If there is a blocked process */
-				if ((process = removeBlocked(&PseudoClock)))
-				{
-					/* Add the process into the Ready Queue */
-					insertProcQ(&ReadyQueue, process);
-					SoftBlockCount--;
-				}
-			}
-		}
-		/* [Case 1.2] There is at most one blocked process */
-		else
-		{
-			/* [Case 1.2.1] 1 blocked process */
-			if ((process = removeBlocked(&PseudoClock)))
-			{
-				/* Add the process into the Ready Queue */
-				insertProcQ(&ReadyQueue, process);
-				SoftBlockCount--;
-				PseudoClock++;
-			}
-			/* [Case 1.2.2] 0 blocked processes */
-			else PseudoClock--;
-		}
-
-		/* Reset the timer tick used to compute the Pseudo-Clock tick */
-		TimerTick = 0;
-		StartTimerTick = getTODLO();
-	}
-	/* [Case 2] The Time Slice for the current process ran out */
-	else if (CurrentProcess)
+	if (async->a_owner)
 	{
-		/* Add the current process into the Ready Queue */
-		insertProcQ(&ReadyQueue, CurrentProcess);
-		CurrentProcess->p_isBlocked = TRUE;
-		CurrentProcess = NULL;
-		SoftBlockCount++;
-
-		/* Update elapsed time */
-		TimerTick += getTODLO() - StartTimerTick;
-		StartTimerTick = getTODLO();
+		async->a_iocb->io_status = status;
+		async->a_iocb->io_done = TRUE;
+		if (async->a_iocb->io_sem) verhogen(async->a_iocb->io_sem);
 	}
-	/* [Case 3] There is no running process */
-	else setTIMER(SCHED_PSEUDO_CLOCK - TimerTick);
+
+	async->a_iocb = NULL;
+	async->a_owner = NULL;
+	SoftBlockCount--;
 }
 
 /**
-@brief Acknowledge a pending interrupt through setting the command code in the device register.
+@brief Tell whether a terminal (sub)device status reports the end of a command.
+@param status Status of the receiver or of the transmitter.
+@return TRUE, if a command is over; FALSE otherwise.
+*/
+HIDDEN int termDone(U32 status)
+{
+	status &= DEV_TERM_STATUS;
+
+	return (status != DEV_NOT_INSTALLED && status != DEV_S_READY && status != DEV_S_BUSY);
+}
+
+/**
+@brief Acknowledge a pending interrupt on the Timer Click.
 @return Void.
 */
-HIDDEN void intDevice(int cause)
+HIDDEN void intTimer()
 {
-	int *deviceBitmap, deviceNumber;
-	dtpreg_t *deviceRegister;
+	/* Run the expired timer events (time slice, real-time periods, Pseudo-Clock tick) */
+	runTimers();
+}
 
-	/* Get the starting address of the device bitmap */
-	deviceBitmap = (int *) CDEV_BITMAP_ADDR(cause);
+/**
+@brief Acknowledge a pending interrupt through setting the command code in the device register.
+@param device Pointer to the device descriptor.
+@return Void.
+*/
+HIDDEN void serveDevice(device_t *device)
+{
+	/* [Case 1] Complete the asynchronous request */
+	if (device->d_async.a_iocb) intComplete(&device->d_async, device->d_register->dtp.status);
+	/* [Case 2] Perform a V on the device semaphore */
+	else intVerhogen(&device->d_sem, device->d_register->dtp.status);
 
-	/* Get the highest priority device affected by a pending interrupt */
-	deviceNumber = getDevice(*deviceBitmap);
+	/* Acknowledge the outstanding interrupt */
+	device->d_register->dtp.command = DEV_C_ACK;
+}
 
-	/* Get the device register */
-	deviceRegister = (dtpreg_t *) DEV_REG_ADDR(cause, deviceNumber);
+/**
+@brief Acknowledge a pending interrupt on a disk, distinguishing between the disk driver and the other commands.
+@param device Pointer to the device descriptor.
+@return Void.
+*/
+HIDDEN void serveDisk(device_t *device)
+{
+	/* [Case 1] The disk driver is serving a request */
+	if (diskCompleted(device - Devices[EXT_IL_INDEX(INT_DISK)], device->d_register->dtp.status)) return;
 
-	/* Perform a V on the device semaphore */
-	switch (cause)
-	{
-		case (INT_DISK):	intVerhogen(&Semaphores.disk[deviceNumber], 	deviceRegister->status);	break;
-		case (INT_TAPE):	intVerhogen(&Semaphores.tape[deviceNumber], 	deviceRegister->status);	break;
-		case (INT_UNUSED):	intVerhogen(&Semaphores.network[deviceNumber], 	deviceRegister->status);	break;
-		case (INT_PRINTER):	intVerhogen(&Semaphores.printer[deviceNumber], 	deviceRegister->status);	break;
-	}
+	/* [Case 2] A command issued through SYS8 or SYS26 */
+	serveDevice(device);
 
-	/* Acknowledge the outstanding interrupt */
-	deviceRegister->command = DEV_C_ACK;
+	/* The disk driver may have deferred its requests until the device was free */
+	diskResume(device - Devices[EXT_IL_INDEX(INT_DISK)]);
 }
 
 /**
 @brief Acknowledge a pending interrupt on the terminal, distinguishing between receiving and sending ones.
+@param device Pointer to the device descriptor.
 @return Void.
 */
-HIDDEN void intTerminal()
+HIDDEN void serveTerminal(device_t *device)
 {
-	int *deviceBitmap, deviceNumber;
-	termreg_t *deviceRegister;
-
-	/* Get the starting address of the device bitmap */
-	deviceBitmap = (int *) CDEV_BITMAP_ADDR(INT_TERMINAL);
+	termreg_t *deviceRegister = &device->d_register->term;
+	int terminal = device - Devices[EXT_IL_INDEX(INT_TERMINAL)];
 
-	/* Get the highest priority device affected by a pending interrupt */
-	deviceNumber = getDevice(*deviceBitmap);
+	/* [Case 1] The buffered terminal driver is receiving */
+	if (termReceived(terminal, deviceRegister->recv_status))
+	{
+#if !INT_DRAIN
+		return;
+#endif
+	}
+	/* [Case 2] An asynchronous reception is over */
+	else if (device->d_async.a_iocb && termDone(deviceRegister->recv_status))
+	{
+		intComplete(&device->d_async, deviceRegister->recv_status);
 
-	/* Get the device status */
-	deviceRegister = (termreg_t *) DEV_REG_ADDR(INT_TERMINAL, deviceNumber);
+		/* Acknowledge the outstanding interrupt */
+		deviceRegister->recv_command = DEV_C_ACK;
 
-	/* [Case 1] Sending a character */
-	if ((deviceRegister->recv_status & DEV_TERM_STATUS) == DEV_TRCV_S_CHARRECV)
+#if !INT_DRAIN
+		return;
+#endif
+	}
+	/* [Case 3] Receiving a character */
+	else if ((deviceRegister->recv_status & DEV_TERM_STATUS) == DEV_TRCV_S_CHARRECV)
 	{
 		/* Perform a V on the device semaphore */
-		intVerhogen(&Semaphores.terminalR[deviceNumber], deviceRegister->recv_status);
+		intVerhogen(&device->d_sem, deviceRegister->recv_status);
 
 		/* Acknowledge the outstanding interrupt */
 		deviceRegister->recv_command = DEV_C_ACK;
+
+#if !INT_DRAIN
+		return;
+#endif
 	}
-	/* [Case 2] Receiving a character */
-	else if ((deviceRegister->transm_status & DEV_TERM_STATUS) == DEV_TTRS_S_CHARTRSM)
+	/* [Case 4] The buffered terminal driver is transmitting (in drain mode, also together with Cases 1-3) */
+	if (termTransmitted(terminal, deviceRegister->transm_status)) return;
+
+	/* [Case 5] An asynchronous transmission is over (in drain mode, also together with Cases 1-3) */
+	if (device->d_asyncTransm.a_iocb && termDone(deviceRegister->transm_status))
+	{
+		intComplete(&device->d_asyncTransm, deviceRegister->transm_status);
+
+		/* Acknowledge the outstanding interrupt */
+		deviceRegister->transm_command = DEV_C_ACK;
+
+		/* The terminal driver may have deferred its characters until the transmitter was free */
+		termResume(terminal);
+		return;
+	}
+
+	/* [Case 6] Transmitting a character (in drain mode, also together with Cases 1-3) */
+	if ((deviceRegister->transm_status & DEV_TERM_STATUS) == DEV_TTRS_S_CHARTRSM)
 	{
 		/* Perform a V on the device semaphore */
-		intVerhogen(&Semaphores.terminalT[deviceNumber], deviceRegister->transm_status);
+		intVerhogen(&device->d_semTransm, deviceRegister->transm_status);
 
 		/* Acknowledge the outstanding interrupt */
 		deviceRegister->transm_command = DEV_C_ACK;
+
+		/* The terminal driver may have deferred its characters until SYS8 released the transmitter */
+		termResume(terminal);
 	}
 }
 
+/* Device class handlers, one for each device interrupt line */
+HIDDEN void (*DeviceHandler[N_EXT_IL])(device_t *device) =
+{
+	serveDisk,		/* INT_DISK */
+	serveDevice,	/* INT_TAPE */
+	serveDevice,	/* INT_UNUSED */
+	serveDevice,	/* INT_PRINTER */
+	serveTerminal	/* INT_TERMINAL */
+};
 
 /**
-@brief The function identifies the pending interrupt and performs a V on the related Semaphores.
+@brief Serve the devices of an interrupt line affected by a pending interrupt: all of them
+in drain mode, otherwise only the highest priority one.
+@param cause Interrupt line.
+@return Void.
+*/
+HIDDEN void intDevice(int cause)
+{
+	U32 bitmap;
+	int line;
+
+	/* Get the device bitmap */
+	line = EXT_IL_INDEX(cause);
+	bitmap = *((U32 *) CDEV_BITMAP_ADDR(cause));
+
+	while (bitmap)
+	{
+		/* Serve the highest priority device affected by a pending interrupt (the lowest set bit) */
+		DeviceHandler[line](&Devices[line][lowestBit(bitmap)]);
+
+#if !INT_DRAIN
+		break;
+#endif
+		/* Move on to the next device */
+		bitmap &= bitmap - 1;
+	}
+}
+
+/**
+@brief The function identifies the pending interrupt and performs a V on the related device semaphores.
 @return Void.
 */
 EXTERN void intHandler()
 {
-	int interruptCause;
+	int interruptCause, line;
 
 	/* If there is a running process */
 	if (CurrentProcess)
@@ -202,17 +235,24 @@ EXTERN void intHandler()
 
 		/* Decrease Program Counter */
 		CurrentProcess->p_s.pc -= WORD_SIZE;
+
+		/* A semaphore fast path cannot be preempted between its load and its store */
+		futexRestart(&(CurrentProcess->p_s));
 	}
 
-	/* Get the interrupt cause and call the handler accordingly */
+	/* Get the interrupt cause and call the handler of each pending line, from the highest priority one */
 	interruptCause = InterruptOldArea->CP15_Cause;
-	if 		(CAUSE_IP_GET(interruptCause, INT_TIMER))		intTimer();				/* Timer */
-	else if (CAUSE_IP_GET(interruptCause, INT_DISK))		intDevice(INT_DISK);	/* Disk */
-	else if (CAUSE_IP_GET(interruptCause, INT_TAPE))		intDevice(INT_TAPE);	/* Tape */
-	else if (CAUSE_IP_GET(interruptCause, INT_UNUSED))		intDevice(INT_UNUSED);	/* Unused */
-	else if (CAUSE_IP_GET(interruptCause, INT_PRINTER))		intDevice(INT_PRINTER);	/* Printer */
-	else if (CAUSE_IP_GET(interruptCause, INT_TERMINAL))	intTerminal();			/* Terminal */
-
-	/* Call the scheduler */
+	for (line = INT_TIMER; line <= INT_TERMINAL; line++)
+	{
+		if (!CAUSE_IP_GET(interruptCause, line)) continue;
+
+		(line == INT_TIMER)? intTimer() : intDevice(line);
+
+#if !INT_DRAIN
+		break;
+#endif
+	}
+
+	/* Reschedule once, after all the pending interrupts have been served */
 	scheduler();
 }
@@ -1,31 +1,627 @@
 /**
 @file scheduler.c
-@note Process scheduler with deadlock detection.
+@note Process scheduler (priority, MLFQ or fair-share policy) with deadlock detection.
 */
 
 #include "../e/dependencies.e"
 
+/* De Bruijn sequence lookup table used to find the lowest set bit of a word */
+HIDDEN const int DeBruijnBitPosition[32] =
+{
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+/**
+@brief Find the lowest set bit of a bitmap (count trailing zeros).
+The ARM7TDMI has no CLZ instruction and libgcc is not linked,
+so a De Bruijn multiplication is used instead of a compiler builtin.
+@param bitmap A non-zero bitmap.
+@return Index of the lowest set bit.
+*/
+EXTERN int lowestBit(U32 bitmap)
+{
+	return DeBruijnBitPosition[((bitmap & -bitmap) * 0x077CB531U) >> 27];
+}
+
+#if SCHED_POLICY == SCHED_MLFQ
+/* MLFQ: number of priority boosts performed so far */
+HIDDEN U32 BoostEpoch = 0;
+
+/* Internal function declarations */
+HIDDEN void boostPriorities(ktimer_t *t);
+
+/* MLFQ: periodic priority boost event, armed only while processes are running */
+HIDDEN ktimer_t BoostTimer = { 0, -1, boostPriorities, NULL };
+
+/**
+@brief (MLFQ) Move a process which used up its whole time slice one priority level down.
+@param p Pointer to the ProcBlk.
+@return Void.
+*/
+EXTERN void demoteProcess(pcb_t *p)
+{
+	if (p->p_priority < PRIO_LEVELS - 1) p->p_priority++;
+}
+
+/**
+@brief (MLFQ) Timer event handler: every MLFQ_BOOST_TICKS Pseudo-Clock ticks of activity,
+move all the processes to the highest priority level to prevent starvation.
+Ready processes are boosted at once by splicing their queues; blocked ones
+are boosted lazily when they become ready again (see insertReady).
+@param t Pointer to the priority boost timer event.
+@return Void.
+*/
+HIDDEN void boostPriorities(ktimer_t *t)
+{
+	pcb_t *it;
+	int i;
+
+	BoostEpoch++;
+
+	/* Boost the running process */
+	if (CurrentProcess)
+	{
+		CurrentProcess->p_priority = 0;
+		CurrentProcess->p_boostEpoch = BoostEpoch;
+	}
+
+	/* Boost the ready processes */
+	for (i = 1; i < PRIO_LEVELS; i++)
+	{
+		if (emptyProcQ(ReadyQueue[i])) continue;
+
+		it = ReadyQueue[i];
+		do
+		{
+			it->p_priority = 0;
+			it->p_boostEpoch = BoostEpoch;
+			it = it->p_next;
+		} while (it != ReadyQueue[i]);
+
+		mergeProcQ(&ReadyQueue[0], &ReadyQueue[i]);
+	}
+
+	if (ReadyBitmap) ReadyBitmap = 1;
+}
+#endif
+
+#if SCHED_POLICY == SCHED_FAIR
+/* Internal function declarations */
+HIDDEN pcb_t *outTimeShare(pcb_t *p);
+
+/* Fair-share: binary min-heap of the ready processes, ordered by virtual runtime */
+HIDDEN pcb_t *FairHeap[MAXPROC];
+
+/* Fair-share: number of ready processes in the heap */
+HIDDEN int FairHeapSize = 0;
+
+/* Fair-share: virtual runtime of the last dispatched process (never decreases) */
+HIDDEN U32 MinVruntime = 0;
+
+/**
+@brief (Fair-share) Compare the virtual runtimes of two processes, taking wrap-around into account.
+@return TRUE, if a has run less than b, otherwise FALSE.
+*/
+HIDDEN int vruntimeBefore(pcb_t *a, pcb_t *b)
+{
+	return (S32) (a->p_vruntime - b->p_vruntime) < 0;
+}
+
+/**
+@brief (Fair-share) Store a process into a slot of the heap.
+@return Void.
+*/
+HIDDEN void heapSet(int i, pcb_t *p)
+{
+	FairHeap[i] = p;
+	p->p_heapIndex = i;
+}
+
+/**
+@brief (Fair-share) Move the process in slot i up, until its parent has a smaller virtual runtime.
+@return Void.
+*/
+HIDDEN void heapSiftUp(int i)
+{
+	pcb_t *p = FairHeap[i];
+
+	for (; i > 0 && vruntimeBefore(p, FairHeap[(i - 1) >> 1]); i = (i - 1) >> 1)
+		heapSet(i, FairHeap[(i - 1) >> 1]);
+
+	heapSet(i, p);
+}
+
+/**
+@brief (Fair-share) Move the process in slot i down, until its children have a larger virtual runtime.
+@return Void.
+*/
+HIDDEN void heapSiftDown(int i)
+{
+	pcb_t *p = FairHeap[i];
+	int child;
+
+	for (; (child = (i << 1) + 1) < FairHeapSize; i = child)
+	{
+		/* Pick the child with the smallest virtual runtime */
+		if (child + 1 < FairHeapSize && vruntimeBefore(FairHeap[child + 1], FairHeap[child])) child++;
+
+		if (!vruntimeBefore(FairHeap[child], p)) break;
+		heapSet(i, FairHeap[child]);
+	}
+
+	heapSet(i, p);
+}
+
+/**
+@brief Insert a process in the ready heap, according to its virtual runtime.
+A process which slept for long is not allowed to monopolize the CPU: its
+virtual runtime is raised up to MinVruntime - FAIR_SLEEPER_CREDIT.
+@param p Pointer to the ProcBlk.
+@return Void.
+*/
+HIDDEN void insertTimeShare(pcb_t *p)
+{
+	if ((S32) (p->p_vruntime - (MinVruntime - FAIR_SLEEPER_CREDIT)) < 0)
+		p->p_vruntime = MinVruntime - FAIR_SLEEPER_CREDIT;
+
+	heapSet(FairHeapSize, p);
+	heapSiftUp(FairHeapSize++);
+}
+
+/**
+@brief Remove the ready process with the smallest virtual runtime.
+@return The removed ProcBlk, or NULL if there are no ready processes.
+*/
+HIDDEN pcb_t *removeTimeShare()
+{
+	pcb_t *output;
+
+	/* Pre-conditions: there is at least one ready process */
+	if (!FairHeapSize) return NULL;
+
+	output = outTimeShare(FairHeap[0]);
+
+	/* Advance the minimum virtual runtime */
+	if ((S32) (output->p_vruntime - MinVruntime) > 0) MinVruntime = output->p_vruntime;
+
+	return output;
+}
+
 /**
-@brief The function updates the CPU time of the running process and re-start the Timer Tick.
+@brief Remove a process from the ready heap.
+@param p Pointer to the ProcBlk.
+@return p, or NULL if p is not ready.
+*/
+HIDDEN pcb_t *outTimeShare(pcb_t *p)
+{
+	int i = p->p_heapIndex;
+
+	/* Pre-conditions: p is in the heap */
+	if (i >= FairHeapSize || FairHeap[i] != p) return NULL;
+
+	/* Replace p with the last process of the heap and restore the heap order */
+	if (i != --FairHeapSize)
+	{
+		heapSet(i, FairHeap[FairHeapSize]);
+		heapSiftDown(i);
+		heapSiftUp(i);
+	}
+
+	FairHeap[FairHeapSize] = NULL;
+
+	return p;
+}
+
+/**
+@brief Check if there are no ready processes.
+@return TRUE, if the ready heap is empty, otherwise FALSE.
+*/
+HIDDEN int emptyTimeShare()
+{
+	return !FairHeapSize;
+}
+#else
+/**
+@brief Insert a process at the tail of the Ready Queue of its priority level.
+@param p Pointer to the ProcBlk.
+@return Void.
+*/
+HIDDEN void insertTimeShare(pcb_t *p)
+{
+#if SCHED_POLICY == SCHED_MLFQ
+	/* A process which missed a priority boost while blocked gets it now */
+	if (p->p_boostEpoch != BoostEpoch)
+	{
+		p->p_priority = 0;
+		p->p_boostEpoch = BoostEpoch;
+	}
+#endif
+	insertProcQ(&ReadyQueue[p->p_priority], p);
+	ReadyBitmap |= 1U << p->p_priority;
+}
+
+/**
+@brief Remove the first process of the highest priority non-empty Ready Queue.
+@return The removed ProcBlk, or NULL if there are no ready processes.
+*/
+HIDDEN pcb_t *removeTimeShare()
+{
+	pcb_t *output;
+	int priority;
+
+	/* Pre-conditions: there is at least one ready process */
+	if (!ReadyBitmap) return NULL;
+
+	priority = lowestBit(ReadyBitmap);
+	output = removeProcQ(&ReadyQueue[priority]);
+
+	/* If the Ready Queue is now empty, clear its bit */
+	if (emptyProcQ(ReadyQueue[priority])) ReadyBitmap &= ~(1U << priority);
+
+	return output;
+}
+
+/**
+@brief Remove a process from the Ready Queue of its priority level.
+@param p Pointer to the ProcBlk.
+@return p, or NULL if p is not ready.
+*/
+HIDDEN pcb_t *outTimeShare(pcb_t *p)
+{
+	pcb_t *output;
+
+	if ((output = outProcQ(&ReadyQueue[p->p_priority], p)))
+	{
+		/* If the Ready Queue is now empty, clear its bit */
+		if (emptyProcQ(ReadyQueue[p->p_priority])) ReadyBitmap &= ~(1U << p->p_priority);
+	}
+
+	return output;
+}
+
+/**
+@brief Check if there are no ready processes.
+@return TRUE, if all the Ready Queues are empty, otherwise FALSE.
+*/
+HIDDEN int emptyTimeShare()
+{
+	return !ReadyBitmap;
+}
+#endif
+
+/* EDF: ready real-time processes */
+HIDDEN pcb_t *EdfQueue = NULL;
+
+/* EDF: real-time processes which used up their budget, waiting for their next period */
+HIDDEN pcb_t *EdfThrottled = NULL;
+
+/* EDF: total utilization of the admitted real-time processes, scaled by EDF_UTIL_SCALE */
+HIDDEN U32 EdfUtilization = 0;
+
+/* Internal function declarations */
+HIDDEN void releaseThrottled(ktimer_t *t);
+HIDDEN void sliceExpired(ktimer_t *t);
+
+/* Time slice (or real-time budget) expiry event of the running process */
+HIDDEN ktimer_t SliceTimer = { 0, -1, sliceExpired, NULL };
+
+/**
+@brief (EDF) Check if the deadline of a is earlier than the one of b, taking wrap-around into account.
+@return TRUE, if a has to run before b, otherwise FALSE.
+*/
+HIDDEN int deadlineBefore(pcb_t *a, pcb_t *b)
+{
+	return (S32) ((a->p_rtRelease + a->p_rtDeadline) - (b->p_rtRelease + b->p_rtDeadline)) < 0;
+}
+
+/**
+@brief (EDF) If one or more periods of a real-time process have elapsed,
+move it to its current period and replenish its budget.
+@param p Pointer to a real-time ProcBlk.
+@param now Current time.
+@return Void.
+*/
+HIDDEN void replenishBudget(pcb_t *p, U32 now)
+{
+	U32 elapsed = now - p->p_rtRelease;
+
+	if (elapsed >= p->p_rtPeriod)
+	{
+		p->p_rtRelease += divide(elapsed, p->p_rtPeriod) * p->p_rtPeriod;
+		p->p_rtLeft = p->p_rtBudget;
+	}
+}
+
+/**
+@brief (EDF) Compute the utilization of a real-time process (density, if its deadline is shorter than its period).
+@return The utilization scaled by EDF_UTIL_SCALE.
+*/
+HIDDEN U32 utilization(U32 budget, U32 deadline)
+{
+	return divide(budget * EDF_UTIL_SCALE, deadline);
+}
+
+/**
+@brief (EDF) Find the ready real-time process with the earliest deadline.
+@return The ProcBlk, or NULL if no real-time process is ready.
+*/
+HIDDEN pcb_t *earliestDeadline()
+{
+	pcb_t *output, *it;
+
+	if (emptyProcQ(EdfQueue)) return NULL;
+
+	output = it = headProcQ(EdfQueue);
+	while ((it = it->p_next) != headProcQ(EdfQueue))
+		if (deadlineBefore(it, output)) output = it;
+
+	return output;
+}
+
+/**
+@brief Insert a process among the ready ones: real-time processes go to the EDF class
+(or wait for their next period, if they used up their budget), the others to the time-sharing class.
+@param p Pointer to the ProcBlk.
+@return Void.
+*/
+EXTERN void insertReady(pcb_t *p)
+{
+	/* [Case 1] Time-sharing process */
+	if (!p->p_rtPeriod) insertTimeShare(p);
+	else
+	{
+		replenishBudget(p, getTODLO());
+
+		/* [Case 2] Real-time process with some budget left */
+		if (p->p_rtLeft) insertProcQ(&EdfQueue, p);
+		/* [Case 3] Real-time process with no budget left: it waits for the next period on the timer */
+		else
+		{
+			insertProcQ(&EdfThrottled, p);
+			SoftBlockCount++;
+			p->p_timer.t_handler = releaseThrottled;
+			armTimer(&p->p_timer, p->p_rtRelease + p->p_rtPeriod);
+		}
+	}
+}
+
+/**
+@brief Remove the ready real-time process with the earliest deadline or, if there is none,
+the next time-sharing process.
+@return The removed ProcBlk, or NULL if there are no ready processes.
+*/
+EXTERN pcb_t *removeReady()
+{
+	/* [Case 1] No real-time process is ready */
+	if (emptyProcQ(EdfQueue)) return removeTimeShare();
+
+	/* [Case 2] Real-time process with the earliest deadline */
+	return outProcQ(&EdfQueue, earliestDeadline());
+}
+
+/**
+@brief Remove a process from the ready ones (or from the throttled real-time ones).
+@param p Pointer to the ProcBlk.
+@return p, or NULL if p is not ready.
+*/
+EXTERN pcb_t *outReady(pcb_t *p)
+{
+	/* [Case 1] Time-sharing process */
+	if (!p->p_rtPeriod) return outTimeShare(p);
+
+	/* [Case 2] Ready real-time process (ready ones always have some budget left) */
+	if (p->p_rtLeft) return outProcQ(&EdfQueue, p);
+
+	/* [Case 3] Throttled real-time process */
+	if (!outProcQ(&EdfThrottled, p)) return NULL;
+	SoftBlockCount--;
+	disarmTimer(&p->p_timer);
+
+	return p;
+}
+
+/**
+@brief Check if there are no ready processes.
+@return TRUE, if there are no ready processes, otherwise FALSE.
+*/
+EXTERN int emptyReady()
+{
+	return emptyProcQ(EdfQueue) && emptyTimeShare();
+}
+
+/**
+@brief (EDF) Make a process real-time, change its parameters or, if period is 0, make it time-sharing again.
+The process is admitted only if the total utilization of the real-time processes,
+sum(budget / min(deadline, period)), does not exceed EDF_UTIL_MAX.
+@param p Pointer to the running ProcBlk.
+@param period Period in microseconds (0 to leave the real-time class).
+@param budget CPU budget per period in microseconds.
+@param deadline Deadline relative to the beginning of each period in microseconds (0 means equal to period).
+@return 0 in case of success; -1 if the parameters are invalid or the admission test fails.
+*/
+EXTERN int setRealTimeClass(pcb_t *p, U32 period, U32 budget, U32 deadline)
+{
+	U32 current, requested;
+
+	if (!deadline) deadline = period;
+
+	/* Pre-conditions: 0 < budget <= deadline <= period */
+	if (period && (!budget || budget > deadline || deadline > period || budget > EDF_BUDGET_MAX)) return -1;
+
+	current = (p->p_rtPeriod)? utilization(p->p_rtBudget, p->p_rtDeadline) : 0;
+	requested = (period)? utilization(budget, deadline) : 0;
+
+	/* Admission test */
+	if (EdfUtilization - current + requested > EDF_UTIL_MAX) return -1;
+	EdfUtilization = EdfUtilization - current + requested;
+
+	/* A new period starts now */
+	p->p_rtPeriod = period;
+	p->p_rtBudget = p->p_rtLeft = budget;
+	p->p_rtDeadline = deadline;
+	p->p_rtRelease = getTODLO();
+
+	return 0;
+}
+
+/**
+@brief (EDF) Timer event handler: the next period of a throttled real-time process has begun.
+@param t Pointer to the timer event of the process.
+@return Void.
+*/
+HIDDEN void releaseThrottled(ktimer_t *t)
+{
+	outProcQ(&EdfThrottled, t->t_proc);
+	SoftBlockCount--;
+	insertReady(t->t_proc);
+}
+
+/**
+@brief Timer event handler: the time slice (or the budget) of the running process ran out.
+A time-sharing process is moved back among the ready ones; a real-time one is
+throttled by the scheduler, since its budget is now over.
+@param t Pointer to the time slice timer event.
+@return Void.
+*/
+HIDDEN void sliceExpired(ktimer_t *t)
+{
+	/* Pre-conditions: there is a running process */
+	if (!CurrentProcess) return;
+
+	/* Charge the process for its last time slice */
+	updateCPUTime();
+
+	if (!CurrentProcess->p_rtPeriod)
+	{
+#if SCHED_POLICY == SCHED_MLFQ
+		/* The process used up its whole time slice: move it one level down */
+		demoteProcess(CurrentProcess);
+#endif
+
+		/* Add the current process into the Ready Queue */
+		insertReady(CurrentProcess);
+		CurrentProcess = NULL;
+	}
+}
+
+/**
+@brief Arm the time slice timer event of the running process: it expires when
+its time slice (or its budget, for a real-time process) runs out.
+@return Void.
+*/
+HIDDEN void armSliceTimer()
+{
+	U32 left;
+
+	/* [Case 1] Real-time process */
+	if (CurrentProcess->p_rtPeriod) left = CurrentProcess->p_rtLeft;
+	/* [Case 2] Time-sharing process */
+	else if (CurrentProcess->p_cpu_time < TIME_SLICE(CurrentProcess->p_priority))
+		left = TIME_SLICE(CurrentProcess->p_priority) - CurrentProcess->p_cpu_time;
+	else left = 0;
+
+	armTimer(&SliceTimer, ProcessTOD + left);
+}
+
+/**
+@brief Check if the running process has to be preempted by a ready one.
+@return TRUE, if a process with a higher priority (or an earlier deadline) is ready
+or the running real-time process used up its budget, otherwise FALSE.
+*/
+HIDDEN int mustPreempt()
+{
+	/* [Case 1] Real-time process: it runs until it blocks, uses up its budget or an earlier deadline is ready */
+	if (CurrentProcess->p_rtPeriod)
+		return !CurrentProcess->p_rtLeft || (!emptyProcQ(EdfQueue) && deadlineBefore(earliestDeadline(), CurrentProcess));
+
+	/* [Case 2] Time-sharing process: any ready real-time process preempts it */
+	if (!emptyProcQ(EdfQueue)) return TRUE;
+
+#if SCHED_POLICY == SCHED_FAIR
+	/* Fair-share processes are only switched at the end of the time slice */
+	return FALSE;
+#else
+	return (ReadyBitmap & PRIO_HIGHER(CurrentProcess->p_priority)) != 0;
+#endif
+}
+
+/**
+@brief Charge the running process for the CPU time elapsed since ProcessTOD.
+@return Void.
+*/
+EXTERN void updateCPUTime()
+{
+	U32 now = getTODLO();
+
+	CurrentProcess->p_cpu_time += now - ProcessTOD;
+
+	/* Consume the budget of a real-time process */
+	if (CurrentProcess->p_rtPeriod)
+		CurrentProcess->p_rtLeft = (now - ProcessTOD >= CurrentProcess->p_rtLeft)? 0 : CurrentProcess->p_rtLeft - (now - ProcessTOD);
+#if SCHED_POLICY == SCHED_FAIR
+	CurrentProcess->p_vruntime += (now - ProcessTOD) * FAIR_WEIGHT(CurrentProcess->p_priority);
+#endif
+	ProcessTOD = now;
+}
+
+/**
+@brief Fast return path of a system call which left the running process running.
+Unless a ready process has to preempt it, the process is resumed at once: its CPU
+time is charged lazily (ProcessTOD keeps running) and its time slice expiry, as
+every timer event, is absolute, so the Interval Timer is reprogrammed only if the
+system call armed an earlier timer event.
+@return Void.
+*/
+EXTERN void resumeProcess()
+{
+	/* Charge the system call for the time spent in the nucleus */
+	chargeSyscall();
+
+#if SYSCALL_FAST_RETURN
+	if (!mustPreempt())
+	{
+		refreshNextTimer();
+		LDST(&(CurrentProcess->p_s));
+	}
+#endif
+
+	/* Otherwise go through the whole scheduler */
+	scheduler();
+}
+
+/**
+@brief The function updates the CPU time of the running process and re-arms its time slice.
 In case there is not a running process, the function performs deadlock detection, initializes
 the CPU time and activate the first process extracted from the Ready Queue.
 @return Void.
 */
 void scheduler()
 {
-	/* [Case 1] There is a running process */
+	/* Charge the system call which led here, if any, for the time spent in the nucleus */
+	chargeSyscall();
+
 	if (CurrentProcess)
 	{
 		/* Set process start time in the CPU */
-		CurrentProcess->p_cpu_time += getTODLO() - ProcessTOD ;
-		ProcessTOD  = getTODLO();
+		updateCPUTime();
+
+		/* If a process with a higher priority is ready (or the real-time budget is over), preempt the running process */
+		if (mustPreempt())
+		{
+			insertReady(CurrentProcess);
+			CurrentProcess = NULL;
+		}
+	}
 
-		/* Update elapsed time of the Pseudo-Clock tick */
-		TimerTick  += getTODLO() - StartTimerTick;
-		StartTimerTick = getTODLO();
+	/* [Case 1] There is a running process */
+	if (CurrentProcess)
+	{
+		/* Keep the time slice (or budget) expiry up to date */
+		armSliceTimer();
 
-		/* Set Interval Timer as the smallest between Time Slice and Pseudo-Clock tick */
-		setTIMER(MIN((SCHED_TIME_SLICE - CurrentProcess->p_cpu_time), (SCHED_PSEUDO_CLOCK - TimerTick )));
+		/* Set Interval Timer to the nearest timer event */
+		setNextTimer();
 
 		/* Load the processor state in order to start execution */
 		LDST(&(CurrentProcess->p_s));
@@ -34,7 +630,7 @@ void scheduler()
 	else
 	{
 		/* If Ready Queue is empty */
-		if (emptyProcQ(ReadyQueue))
+		if (emptyReady())
 		{
 			/* [Case 2.1] There are no more processes */
 			if (ProcessCount == 0) HALT();
@@ -43,6 +639,13 @@ void scheduler()
 			/* [Case 2.3] At least one process is blocked */
 			if (ProcessCount > 0 && SoftBlockCount > 0)
 			{
+				/* No time slice is running: wake up only for the next timer event, if any */
+				disarmTimer(&SliceTimer);
+#if SCHED_POLICY == SCHED_MLFQ
+				disarmTimer(&BoostTimer);
+#endif
+				setNextTimer();
+
 				/* Enable interrupts */
 				setSTATUS(STATUS_ALL_INT_ENABLE(getSTATUS()));
 
@@ -52,19 +655,21 @@ void scheduler()
 			PANIC(); /* Anomaly */
 		}
 
-		/* Otherwise extract first ready process */
-		if (!(CurrentProcess = removeProcQ(&ReadyQueue))) PANIC(); /* Anomaly */
-
-		/* Compute elapsed time from the Pseudo-Clock tick */
-		TimerTick  += getTODLO() - StartTimerTick;
-		StartTimerTick = getTODLO();
+		/* Otherwise extract the first ready process with the highest priority */
+		if (!(CurrentProcess = removeReady())) PANIC(); /* Anomaly */
 
 		/* Initialize CPU time */
 		CurrentProcess->p_cpu_time = 0;
 		ProcessTOD = getTODLO();
 
-		/* Set Interval Timer as the smallest between Time Slice and Pseudo-Clock tick */
-		setTIMER(MIN(SCHED_TIME_SLICE, (SCHED_PSEUDO_CLOCK - TimerTick )));
+#if SCHED_POLICY == SCHED_MLFQ
+		/* Start counting towards the next priority boost */
+		if (BoostTimer.t_index < 0) armTimer(&BoostTimer, ProcessTOD + MLFQ_BOOST_TICKS * SCHED_PSEUDO_CLOCK);
+#endif
+
+		/* Start the time slice and set Interval Timer to the nearest timer event */
+		armSliceTimer();
+		setNextTimer();
 
 		/* Load the processor state in order to start execution */
 		LDST(&(CurrentProcess->p_s));
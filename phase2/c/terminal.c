@@ -0,0 +1,345 @@
+/**
+@file terminal.c
+@note Buffered terminal driver: a process hands a whole string to the nucleus (SYS14),
+which transmits it one character at a time from interrupt context. With TERM_READ,
+the received characters are buffered too, whether a process is reading (SYS13) or not.
+*/
+
+#include "../e/dependencies.e"
+
+/* Transmission ring buffers, one for each terminal */
+HIDDEN termring_t TermTx[DEV_PER_INT];
+
+/* Reception ring buffers, one for each terminal */
+HIDDEN termring_t TermRx[DEV_PER_INT];
+
+/**
+@brief Get the register of a terminal.
+@param terminal Terminal number.
+@return Pointer to the terminal register.
+*/
+HIDDEN termreg_t *termRegister(int terminal)
+{
+	return &Devices[EXT_IL_INDEX(INT_TERMINAL)][terminal].d_register->term;
+}
+
+/**
+@brief Copy into the transmission ring buffer as many characters of a writer as fit.
+The saved state of the writer keeps track of its request: a2 is the address of the
+characters still to be buffered, a3 their number.
+@param ring Pointer to the ring buffer.
+@param writer Pointer to the ProcBlk of the writer.
+@return Void.
+*/
+HIDDEN void termFill(termring_t *ring, pcb_t *writer)
+{
+	char *buffer = (char *) writer->p_s.a2;
+
+	while (writer->p_s.a3 && ring->r_count < TERM_BUF_SIZE)
+	{
+		ring->r_data[(ring->r_head + ring->r_count++) & TERM_BUF_MASK] = *buffer++;
+		writer->p_s.a3--;
+	}
+
+	writer->p_s.a2 = (memaddr) buffer;
+}
+
+/**
+@brief Tell whether the transmitter of a terminal can be used by the driver: it is ready, and
+no asynchronous request and no SYS8 (a waiter, or a completion not reaped yet) are using it.
+@param terminal Terminal number.
+@return TRUE, if the transmitter is free; FALSE otherwise.
+*/
+HIDDEN int termTransmFree(int terminal)
+{
+	device_t *device = &Devices[EXT_IL_INDEX(INT_TERMINAL)][terminal];
+
+	return ((device->d_register->term.transm_status & DEV_TERM_STATUS) == DEV_S_READY &&
+		!device->d_asyncTransm.a_iocb && device->d_semTransm == 0);
+}
+
+/**
+@brief Start the transmission of the first buffered character, if any.
+@param terminal Terminal number.
+@return Void.
+*/
+HIDDEN void termSend(int terminal)
+{
+	termring_t *ring = &TermTx[terminal];
+
+	if ((ring->r_busy = (ring->r_count > 0)))
+		termRegister(terminal)->transm_command = DEV_TTRS_C_TRSMCHAR | (((U32) (U8) ring->r_data[ring->r_head]) << TERM_CHAR_SHIFT);
+}
+
+/**
+@brief Wake up the first process (writer or reader) waiting on a ring buffer.
+@param ring Pointer to the ring buffer.
+@return Void.
+*/
+HIDDEN void termWake(termring_t *ring)
+{
+	pcb_t *process = removeBlocked(&ring->r_waiters);
+
+	SoftBlockCount--;
+	process->p_isBlocked = FALSE;
+	insertReady(process);
+}
+
+/**
+@brief Give a received character to a reader.
+The saved state of the reader keeps track of its request: a1 is the number of characters
+read so far, a2 the address where the next one goes, a3 the room left.
+@param reader Pointer to the ProcBlk of the reader.
+@param c Received character.
+@return TRUE, if the read is complete (end of line or no room left); FALSE otherwise.
+*/
+HIDDEN int termDeliver(pcb_t *reader, char c)
+{
+	*((char *) reader->p_s.a2) = c;
+	reader->p_s.a1++;
+	reader->p_s.a2++;
+
+	return (c == TERM_EOL || !--reader->p_s.a3);
+}
+
+/**
+@brief Issue the command to receive the next character.
+@param terminal Terminal number.
+@return Void.
+*/
+HIDDEN void termListen(int terminal)
+{
+	termRegister(terminal)->recv_command = DEV_TRCV_C_RECVCHAR;
+}
+
+/**
+@brief (SYS14) Write a string on a terminal.
+The characters are copied into the transmission buffer of the terminal and the caller goes on
+at once. If they do not fit (or other writers are waiting), the caller is blocked, and woken up
+as soon as the buffer drained enough to hold all of its characters.
+@param buffer Address of the characters.
+@param length Number of characters.
+@param terminal Terminal number.
+@return The number of characters written; minus the device status in case of a transmission error;
+-1 if the terminal does not exist or is not installed.
+*/
+EXTERN int writeTerminal(char *buffer, U32 length, int terminal)
+{
+	termring_t *ring;
+
+	/* Pre-conditions: the terminal exists and its transmitter is installed */
+	if (terminal < 0 || terminal >= DEV_PER_INT) return -1;
+	if ((termRegister(terminal)->transm_status & DEV_TERM_STATUS) == DEV_NOT_INSTALLED) return -1;
+
+	ring = &TermTx[terminal];
+
+	/* The request is tracked in the saved state of the caller (see termFill) */
+	CurrentProcess->p_s.a2 = (memaddr) buffer;
+	CurrentProcess->p_s.a3 = length;
+
+	/* [Case 1] No writer is waiting: buffer as many characters as possible */
+	if (!headBlocked(&ring->r_waiters))
+	{
+		termFill(ring, CurrentProcess);
+		termResume(terminal);
+
+		/* All the characters have been buffered */
+		if (!CurrentProcess->p_s.a3) return length;
+	}
+
+	/* [Case 2] Wait for the buffer to drain */
+	CurrentProcess->p_s.a1 = length;
+	if (insertBlocked(&ring->r_waiters, CurrentProcess)) PANIC(); /* Anomaly */
+	updateCPUTime();
+	SoftBlockCount++;
+	CurrentProcess->p_isBlocked = TRUE;
+	CurrentProcess = NULL;
+
+	/* Call the scheduler */
+	scheduler();
+
+	return length; /* Not reached */
+}
+
+/**
+@brief Handle a transmission interrupt of a terminal, if the driver is using it.
+On success the next buffered character is sent; once the buffer has drained, it is refilled
+from the waiting writers, which are woken up as soon as all their characters are buffered.
+On error the buffer is dropped and all the waiting writers fail.
+@param terminal Terminal number.
+@param status Transmission status of the terminal.
+@return TRUE, if the interrupt has been handled by the driver; FALSE otherwise.
+*/
+EXTERN int termTransmitted(int terminal, U32 status)
+{
+	termring_t *ring = &TermTx[terminal];
+
+	status &= DEV_TERM_STATUS;
+
+	/* Pre-conditions: the driver is transmitting on the terminal, and the transmission is over */
+	if (!ring->r_busy || (status != DEV_TTRS_S_CHARTRSM && status != DEV_TTRS_S_TRSMERR)) return FALSE;
+
+	/* [Case 1] Transmission error: drop the buffer and fail the waiting writers */
+	if (status == DEV_TTRS_S_TRSMERR)
+	{
+		ring->r_count = 0;
+		while (headBlocked(&ring->r_waiters))
+		{
+			headBlocked(&ring->r_waiters)->p_s.a1 = -status;
+			termWake(ring);
+		}
+	}
+	/* [Case 2] The character has been transmitted */
+	else
+	{
+		ring->r_head = (ring->r_head + 1) & TERM_BUF_MASK;
+
+		/* Once the buffer has drained, refill it from the waiting writers */
+		if (!--ring->r_count)
+			while (headBlocked(&ring->r_waiters))
+			{
+				termFill(ring, headBlocked(&ring->r_waiters));
+				if (headBlocked(&ring->r_waiters)->p_s.a3) break;
+
+				/* All the characters of the writer have been buffered */
+				termWake(ring);
+			}
+	}
+
+	/* Acknowledge the interrupt, sending the next character if any */
+	termSend(terminal);
+	if (!ring->r_busy) termRegister(terminal)->transm_command = DEV_C_ACK;
+
+	return TRUE;
+}
+
+/**
+@brief Start the transmission of the buffered characters of a terminal, unless the driver is
+already transmitting or the transmitter is still used by an asynchronous request or by SYS8
+(the transmission is then deferred until the transmitter is released).
+@param terminal Terminal number.
+@return Void.
+*/
+EXTERN void termResume(int terminal)
+{
+	if (!TermTx[terminal].r_busy && termTransmFree(terminal)) termSend(terminal);
+}
+
+/**
+@brief (SYS13) Read a line from a terminal.
+The characters already received are taken from the reception buffer of the terminal
+without blocking; if they do not complete the line, the caller waits for the next ones.
+@param buffer Address where the characters are stored.
+@param length Room in the buffer.
+@param terminal Terminal number.
+@return The number of characters read, up to the end of line (TERM_EOL) included; minus the
+device status in case of a reception error; -1 if the terminal does not exist.
+*/
+EXTERN int readTerminal(char *buffer, U32 length, int terminal)
+{
+	termring_t *ring;
+	char c;
+
+	/* Pre-conditions: the terminal exists and the buffer is not empty */
+	if (terminal < 0 || terminal >= DEV_PER_INT || !TermRx[terminal].r_busy) return -1;
+	if (!length) return 0;
+
+	ring = &TermRx[terminal];
+
+	/* The request is tracked in the saved state of the caller (see termDeliver) */
+	CurrentProcess->p_s.a1 = 0;
+	CurrentProcess->p_s.a2 = (memaddr) buffer;
+	CurrentProcess->p_s.a3 = length;
+
+	/* [Case 1] No reader is waiting: take the buffered characters */
+	if (!headBlocked(&ring->r_waiters))
+		while (ring->r_count)
+		{
+			c = ring->r_data[ring->r_head];
+			ring->r_head = (ring->r_head + 1) & TERM_BUF_MASK;
+			ring->r_count--;
+
+			/* The line is complete */
+			if (termDeliver(CurrentProcess, c)) return CurrentProcess->p_s.a1;
+		}
+
+	/* [Case 2] Wait for the next characters */
+	if (insertBlocked(&ring->r_waiters, CurrentProcess)) PANIC(); /* Anomaly */
+	updateCPUTime();
+	SoftBlockCount++;
+	CurrentProcess->p_isBlocked = TRUE;
+	CurrentProcess = NULL;
+
+	/* Call the scheduler */
+	scheduler();
+
+	return 0; /* Not reached */
+}
+
+/**
+@brief Handle a reception interrupt of a terminal, if the driver is using it.
+The character goes to the first waiting reader, otherwise into the reception buffer
+(it is dropped if the buffer is full); then the next character is requested.
+@param terminal Terminal number.
+@param status Reception status of the terminal.
+@return TRUE, if the interrupt has been handled by the driver; FALSE otherwise.
+*/
+EXTERN int termReceived(int terminal, U32 status)
+{
+	termring_t *ring = &TermRx[terminal];
+	pcb_t *reader;
+
+	/* Pre-conditions: the driver is receiving on the terminal, and a reception is over */
+	if (!ring->r_busy || ((status & DEV_TERM_STATUS) != DEV_TRCV_S_CHARRECV && (status & DEV_TERM_STATUS) != DEV_TRCV_S_RECVERR))
+		return FALSE;
+
+	reader = headBlocked(&ring->r_waiters);
+
+	/* [Case 1] Reception error: fail the first waiting reader */
+	if ((status & DEV_TERM_STATUS) == DEV_TRCV_S_RECVERR)
+	{
+		if (reader)
+		{
+			reader->p_s.a1 = -(status & DEV_TERM_STATUS);
+			termWake(ring);
+		}
+	}
+	/* [Case 2] A reader is waiting: give it the character */
+	else if (reader)
+	{
+		if (termDeliver(reader, (char) (status >> TERM_CHAR_SHIFT))) termWake(ring);
+	}
+	/* [Case 3] Nobody is waiting: buffer the character, if there is room */
+	else if (ring->r_count < TERM_BUF_SIZE)
+		ring->r_data[(ring->r_head + ring->r_count++) & TERM_BUF_MASK] = (char) (status >> TERM_CHAR_SHIFT);
+
+	/* Acknowledge the interrupt, asking for the next character */
+	termListen(terminal);
+
+	return TRUE;
+}
+
+/**
+@brief Initialize the terminal driver: with TERM_READ, start receiving on every installed terminal.
+This method shall be called only once during data structure initialization.
+@return Void.
+*/
+EXTERN void initTerminals()
+{
+	int i;
+
+	for (i = 0; i < DEV_PER_INT; i++)
+	{
+		TermTx[i].r_head = TermTx[i].r_count = TermRx[i].r_head = TermRx[i].r_count = 0;
+		TermTx[i].r_waiters = TermRx[i].r_waiters = 0;
+		TermTx[i].r_busy = TermRx[i].r_busy = FALSE;
+
+#if TERM_READ
+		if ((termRegister(i)->recv_status & DEV_TERM_STATUS) != DEV_NOT_INSTALLED)
+		{
+			TermRx[i].r_busy = TRUE;
+			termListen(i);
+		}
+#endif
+	}
+}
@@ -0,0 +1,381 @@
+/**
+@file timer.c
+@note Kernel timer events: a min-heap of absolute deadlines driving the Interval Timer.
+*/
+
+#include "../e/dependencies.e"
+
+/* Internal function declarations */
+HIDDEN void pseudoClockTick(ktimer_t *t);
+HIDDEN void wheelTick(ktimer_t *t);
+
+/* Timer queue: binary min-heap of the armed timer events, ordered by expiry time */
+HIDDEN ktimer_t *TimerQueue[TIMER_MAX];
+
+/* Number of armed timer events */
+HIDDEN int TimerQueueSize = 0;
+
+/* Timer event (and its expiry) the Interval Timer was last programmed for, NULL if none */
+HIDDEN ktimer_t *NextTimer = NULL;
+HIDDEN U32 NextTimerExpiry = 0;
+
+/* Pseudo-Clock tick event, armed only while some process waits for it */
+HIDDEN ktimer_t PseudoClockTimer;
+
+/* Time of the first Pseudo-Clock tick: all the ticks are aligned to it */
+HIDDEN U32 PseudoClockBase;
+
+/* Timing wheel of the sleeping processes: a ProcQ for each slot of each level */
+HIDDEN pcb_t *TimingWheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Current tick of the timing wheel */
+HIDDEN U32 WheelNow = 0;
+
+/* Number of sleeping processes */
+HIDDEN U32 WheelSleepers = 0;
+
+/* Timing wheel tick event, armed only while some process is sleeping */
+HIDDEN ktimer_t WheelTimer;
+
+/**
+@brief Unsigned integer division (the ARM7TDMI has no divide instruction and libgcc is not linked).
+@param dividend Dividend.
+@param divisor A non-zero divisor.
+@return The quotient.
+*/
+EXTERN U32 divide(U32 dividend, U32 divisor)
+{
+	U32 quotient = 0, remainder = 0;
+	int i;
+
+	for (i = 31; i >= 0; i--)
+	{
+		remainder = (remainder << 1) | ((dividend >> i) & 1);
+		if (remainder >= divisor)
+		{
+			remainder -= divisor;
+			quotient |= 1U << i;
+		}
+	}
+
+	return quotient;
+}
+
+/**
+@brief Compare the expiry times of two timer events, taking wrap-around into account.
+@return TRUE, if a expires before b, otherwise FALSE.
+*/
+HIDDEN int expiresBefore(ktimer_t *a, ktimer_t *b)
+{
+	return (S32) (a->t_expiry - b->t_expiry) < 0;
+}
+
+/**
+@brief Store a timer event into a slot of the timer queue.
+@return Void.
+*/
+HIDDEN void timerSet(int i, ktimer_t *t)
+{
+	TimerQueue[i] = t;
+	t->t_index = i;
+}
+
+/**
+@brief Move the timer event in slot i up, until its parent expires earlier.
+@return Void.
+*/
+HIDDEN void timerSiftUp(int i)
+{
+	ktimer_t *t = TimerQueue[i];
+
+	for (; i > 0 && expiresBefore(t, TimerQueue[(i - 1) >> 1]); i = (i - 1) >> 1)
+		timerSet(i, TimerQueue[(i - 1) >> 1]);
+
+	timerSet(i, t);
+}
+
+/**
+@brief Move the timer event in slot i down, until its children expire later.
+@return Void.
+*/
+HIDDEN void timerSiftDown(int i)
+{
+	ktimer_t *t = TimerQueue[i];
+	int child;
+
+	for (; (child = (i << 1) + 1) < TimerQueueSize; i = child)
+	{
+		/* Pick the child which expires first */
+		if (child + 1 < TimerQueueSize && expiresBefore(TimerQueue[child + 1], TimerQueue[child])) child++;
+
+		if (!expiresBefore(TimerQueue[child], t)) break;
+		timerSet(i, TimerQueue[child]);
+	}
+
+	timerSet(i, t);
+}
+
+/**
+@brief Initialize a timer event.
+@param t Pointer to the timer event.
+@param handler Function called on expiry.
+@param proc Process the event refers to (may be NULL).
+@return Void.
+*/
+EXTERN void initTimer(ktimer_t *t, void (*handler)(ktimer_t *t), pcb_t *proc)
+{
+	t->t_expiry = 0;
+	t->t_index = -1;
+	t->t_handler = handler;
+	t->t_proc = proc;
+}
+
+/**
+@brief Arm a timer event (or move it, if already armed) so that it expires at the given time.
+@param t Pointer to the timer event.
+@param expiry Absolute expiry time (TOD).
+@return Void.
+*/
+EXTERN void armTimer(ktimer_t *t, U32 expiry)
+{
+	t->t_expiry = expiry;
+
+	/* [Case 1] The event is not armed: append it */
+	if (t->t_index < 0)
+	{
+		timerSet(TimerQueueSize, t);
+		timerSiftUp(TimerQueueSize++);
+	}
+	/* [Case 2] The event is armed: restore the heap order */
+	else
+	{
+		timerSiftDown(t->t_index);
+		timerSiftUp(t->t_index);
+	}
+}
+
+/**
+@brief Disarm a timer event, if armed.
+@param t Pointer to the timer event.
+@return Void.
+*/
+EXTERN void disarmTimer(ktimer_t *t)
+{
+	int i = t->t_index;
+
+	/* Pre-conditions: the event is armed */
+	if (i < 0) return;
+
+	/* Replace the event with the last one of the heap and restore the heap order */
+	if (i != --TimerQueueSize)
+	{
+		timerSet(i, TimerQueue[TimerQueueSize]);
+		timerSiftDown(i);
+		timerSiftUp(i);
+	}
+
+	TimerQueue[TimerQueueSize] = NULL;
+	t->t_index = -1;
+}
+
+/**
+@brief Disarm and run, in expiry order, all the timer events which expired.
+@return Void.
+*/
+EXTERN void runTimers()
+{
+	ktimer_t *t;
+
+	while (TimerQueueSize && (S32) (TimerQueue[0]->t_expiry - getTODLO()) <= 0)
+	{
+		t = TimerQueue[0];
+		disarmTimer(t);
+		t->t_handler(t);
+	}
+}
+
+/**
+@brief Program the Interval Timer for the nearest armed timer event.
+If no event is armed, the timer is set far away, so that an idle machine gets no interrupts.
+@return Void.
+*/
+EXTERN void setNextTimer()
+{
+	S32 left;
+
+	/* [Case 1] No armed events */
+	if (!TimerQueueSize)
+	{
+		NextTimer = NULL;
+		setTIMER(TIMER_IDLE);
+	}
+	/* [Case 2] Wait for the nearest event (at least one tick) */
+	else
+	{
+		NextTimer = TimerQueue[0];
+		NextTimerExpiry = NextTimer->t_expiry;
+		left = (S32) (NextTimerExpiry - getTODLO());
+		setTIMER((left > 0)? (U32) left : 1);
+	}
+}
+
+/**
+@brief Program the Interval Timer again only if the nearest armed timer event changed
+since the last call to setNextTimer().
+@return Void.
+*/
+EXTERN void refreshNextTimer()
+{
+	if (!TimerQueueSize)
+	{
+		if (NextTimer) setNextTimer();
+	}
+	else if (TimerQueue[0] != NextTimer || TimerQueue[0]->t_expiry != NextTimerExpiry) setNextTimer();
+}
+
+/**
+@brief Pseudo-Clock tick: wake up all the processes waiting for it.
+@param t Pointer to the Pseudo-Clock timer event.
+@return Void.
+*/
+HIDDEN void pseudoClockTick(ktimer_t *t)
+{
+	pcb_t *process, *woken;
+
+	/* Unleash all of them at once */
+	woken = mkEmptyProcQ();
+	SoftBlockCount -= removeAllBlocked(&PseudoClock, &woken);
+	PseudoClock = 0;
+
+	/* Move them into the Ready Queue */
+	while ((process = removeProcQ(&woken)))
+	{
+		process->p_isBlocked = FALSE;
+		insertReady(process);
+	}
+}
+
+/**
+@brief Compute the time of the next Pseudo-Clock tick, i.e. the next multiple of
+SCHED_PSEUDO_CLOCK since the first tick.
+@return Absolute time (TOD) of the next tick.
+*/
+HIDDEN U32 nextPseudoClockTick()
+{
+	U32 elapsed = getTODLO() - PseudoClockBase;
+
+	return PseudoClockBase + (divide(elapsed, SCHED_PSEUDO_CLOCK) + 1) * SCHED_PSEUDO_CLOCK;
+}
+
+/**
+@brief Make sure that the Pseudo-Clock tick event is armed, at the next Pseudo-Clock tick.
+Between two waits the machine gets no ticks at all.
+@return Void.
+*/
+EXTERN void armPseudoClock()
+{
+	if (PseudoClockTimer.t_index < 0) armTimer(&PseudoClockTimer, nextPseudoClockTick());
+}
+
+/**
+@brief Put a sleeping process into the slot of the timing wheel matching its wake-up tick:
+the lowest level whose span covers the ticks left.
+@param p Pointer to the ProcBlk.
+@return Void.
+*/
+HIDDEN void wheelInsert(pcb_t *p)
+{
+	U32 left = p->p_wakeTick - WheelNow;
+	int level = 0;
+
+	while (level < WHEEL_LEVELS - 1 && left >= (1U << (WHEEL_BITS * (level + 1)))) level++;
+
+	p->p_wheelSlot = &TimingWheel[level][(p->p_wakeTick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	insertProcQ(p->p_wheelSlot, p);
+}
+
+/**
+@brief Timer event handler: advance the timing wheel by one tick.
+The slots of the upper levels reached by the tick are cascaded one level down,
+then all the processes of the current slot of the lowest level are woken up.
+Each process is cascaded at most WHEEL_LEVELS - 1 times, so a tick costs O(1)
+amortized, no matter how many processes are sleeping.
+@param t Pointer to the timing wheel tick event.
+@return Void.
+*/
+HIDDEN void wheelTick(ktimer_t *t)
+{
+	pcb_t *process, *slot;
+	int level;
+
+	WheelNow++;
+
+	/* [Case 1] Cascade the upper levels whose index has just advanced */
+	for (level = 1; level < WHEEL_LEVELS && !(WheelNow & ((1U << (WHEEL_BITS * level)) - 1)); level++)
+	{
+		slot = mkEmptyProcQ();
+		mergeProcQ(&slot, &TimingWheel[level][(WheelNow >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+		while ((process = removeProcQ(&slot))) wheelInsert(process);
+	}
+
+	/* [Case 2] Wake up the processes of the current slot */
+	while ((process = removeProcQ(&TimingWheel[0][WheelNow & WHEEL_MASK])))
+	{
+		process->p_wheelSlot = NULL;
+		WheelSleepers--;
+		SoftBlockCount--;
+		insertReady(process);
+	}
+
+	/* Keep ticking while some process is sleeping (a late tick is caught up at once) */
+	if (WheelSleepers) armTimer(t, t->t_expiry + SCHED_PSEUDO_CLOCK);
+}
+
+/**
+@brief Put a process to sleep on the timing wheel for a number of Pseudo-Clock ticks.
+@param p Pointer to the ProcBlk.
+@param ticks Number of Pseudo-Clock ticks (at least 1, at most WHEEL_MAX_TICKS).
+@return Void.
+*/
+EXTERN void insertSleeping(pcb_t *p, U32 ticks)
+{
+	/* Start ticking at the next Pseudo-Clock tick */
+	if (!WheelSleepers++) armTimer(&WheelTimer, nextPseudoClockTick());
+
+	p->p_wakeTick = WheelNow + ticks;
+	wheelInsert(p);
+	SoftBlockCount++;
+}
+
+/**
+@brief Remove a sleeping process from the timing wheel before its wake-up tick.
+@param p Pointer to the ProcBlk.
+@return p, if it was sleeping; NULL otherwise.
+*/
+EXTERN pcb_t *outSleeping(pcb_t *p)
+{
+	/* Pre-conditions: the process is sleeping */
+	if (!p->p_wheelSlot) return NULL;
+
+	outProcQ(p->p_wheelSlot, p);
+	p->p_wheelSlot = NULL;
+	SoftBlockCount--;
+
+	/* Stop ticking when no process is sleeping */
+	if (!--WheelSleepers) disarmTimer(&WheelTimer);
+
+	return p;
+}
+
+/**
+@brief Initialize the timer queue and the Pseudo-Clock tick.
+This method shall be called only once during data structure initialization.
+@return Void.
+*/
+EXTERN void initTimers()
+{
+	TimerQueueSize = 0;
+	initTimer(&PseudoClockTimer, pseudoClockTick, NULL);
+	initTimer(&WheelTimer, wheelTick, NULL);
+	PseudoClockBase = getTODLO();
+}
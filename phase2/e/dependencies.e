@@ -19,4 +19,8 @@
 #include "initial.e"
 #include "scheduler.e"
 #include "exceptions.e"
-#include "interrupts.e"
\ No newline at end of file
+#include "interrupts.e"
+#include "timer.e"
+#include "futex.e"
+#include "terminal.e"
+#include "disk.e"
\ No newline at end of file
@@ -0,0 +1,14 @@
+/*
+@file disk.e
+@brief External definitions for disk.c
+*/
+
+#include "../../include/types.h"
+
+EXTERN int diskGet(memaddr buffer, int disk, U32 sector);
+EXTERN int diskPut(memaddr buffer, int disk, U32 sector);
+EXTERN int diskCompleted(int disk, U32 status);
+EXTERN void diskResume(int disk);
+EXTERN void diskCancel(pcb_t *process);
+EXTERN void diskStats(diskstat_t *buffer);
+EXTERN void initDisks();
\ No newline at end of file
@@ -17,3 +17,13 @@ EXTERN void waitClock();
 EXTERN unsigned int waitIO(int interruptLine, int deviceNumber, int reading);
 EXTERN void tlbHandler();
 EXTERN void pgmTrapHandler();
+EXTERN U32 getPriority();
+EXTERN int setPriority(int priority);
+EXTERN int setRealTime(U32 period, U32 budget, U32 deadline);
+EXTERN void delay(U32 ticks);
+EXTERN int tryPasseren(int *semaddr);
+EXTERN int timedPasseren(int *semaddr, U32 timeout);
+EXTERN U32 syscallBatch(sysop_t *ops, U32 count);
+EXTERN void chargeSyscall();
+EXTERN U32 syscallStats(sysstat_t *buffer, U32 count);
+EXTERN int submitIO(iocb_t *iocb);
@@ -0,0 +1,8 @@
+/*
+@file futex.e
+@brief External definitions for futex.c
+*/
+
+EXTERN void fastPasseren(int *semaddr);
+EXTERN void fastVerhogen(int *semaddr);
+EXTERN void futexRestart(state_t *state);
\ No newline at end of file
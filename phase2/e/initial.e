@@ -9,9 +9,8 @@
 EXTERN U32 ProcessCount;
 EXTERN U32 SoftBlockCount;
 EXTERN U32 ProcessTOD;
-EXTERN U32 TimerTick;
-EXTERN U32 StartTimerTick;
-EXTERN pcb_t *ReadyQueue;
+EXTERN pcb_t *ReadyQueue[PRIO_LEVELS];
+EXTERN U32 ReadyBitmap;
 EXTERN pcb_t *CurrentProcess;
-EXTERN DeviceSemaphores Semaphores;
+EXTERN device_t Devices[N_EXT_IL][DEV_PER_INT];
 EXTERN S32 PseudoClock;
\ No newline at end of file
@@ -3,4 +3,15 @@
 @brief External definitions for scheduler.c
 */
  
-EXTERN void scheduler();
\ No newline at end of file
+EXTERN int lowestBit(U32 bitmap);
+EXTERN void scheduler();
+EXTERN void resumeProcess();
+EXTERN void insertReady(pcb_t *p);
+EXTERN pcb_t *removeReady();
+EXTERN pcb_t *outReady(pcb_t *p);
+EXTERN int emptyReady();
+EXTERN void updateCPUTime();
+EXTERN int setRealTimeClass(pcb_t *p, U32 period, U32 budget, U32 deadline);
+#if SCHED_POLICY == SCHED_MLFQ
+EXTERN void demoteProcess(pcb_t *p);
+#endif
\ No newline at end of file
@@ -0,0 +1,13 @@
+/*
+@file terminal.e
+@brief External definitions for terminal.c
+*/
+
+#include "../../include/types.h"
+
+EXTERN int writeTerminal(char *buffer, U32 length, int terminal);
+EXTERN int termTransmitted(int terminal, U32 status);
+EXTERN void termResume(int terminal);
+EXTERN int readTerminal(char *buffer, U32 length, int terminal);
+EXTERN int termReceived(int terminal, U32 status);
+EXTERN void initTerminals();
\ No newline at end of file
@@ -0,0 +1,18 @@
+/*
+@file timer.e
+@brief External definitions for timer.c
+*/
+
+#include "../../include/types.h"
+
+EXTERN U32 divide(U32 dividend, U32 divisor);
+EXTERN void initTimer(ktimer_t *t, void (*handler)(ktimer_t *t), pcb_t *proc);
+EXTERN void armTimer(ktimer_t *t, U32 expiry);
+EXTERN void disarmTimer(ktimer_t *t);
+EXTERN void runTimers();
+EXTERN void setNextTimer();
+EXTERN void refreshNextTimer();
+EXTERN void armPseudoClock();
+EXTERN void insertSleeping(pcb_t *p, U32 ticks);
+EXTERN pcb_t *outSleeping(pcb_t *p);
+EXTERN void initTimers();
\ No newline at end of file
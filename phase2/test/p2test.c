@@ -37,6 +37,7 @@
 #include "../../include/base.h"
 #include "../../include/const.h"
 #include "../../include/libuarm.h"
+#include "../../include/types.h"
 
 typedef unsigned int devregtr;
 
@@ -48,6 +49,10 @@ typedef unsigned int devregtr;
 #define TRANSM 5
 
 #define CLOCKINTERVAL	100000UL	/* interval to V clock semaphore */
+#define TIMEOUT			(CLOCKINTERVAL >> 1)	/* timeout of the timed P that expires */
+#define LONGTIMEOUT		(10 * CLOCKINTERVAL)	/* timeout of the timed P that p1 satisfies */
+#define SHORTDELAY		3				/* SYS17 ticks within the first level of the timing wheel */
+#define LONGDELAY		(WHEEL_SIZE + 2)	/* SYS17 ticks cascading from the second level */
 
 #define TERMSTATMASK	0xFF
 #define TERMCHARMASK	0xFF00
@@ -74,6 +79,13 @@ typedef unsigned int devregtr;
 #define SYSOLDVECT		6
 
 #define CREATENOGOOD	-1
+#define PNOGOOD			-1	/* SYS12 or SYS22 could not perform the P */
+#define SUBMITNOGOOD	-1
+#define DISKNOGOOD		-1	/* SYS18 or SYS19 on a nonexistent disk or sector */
+
+#define DISKWORDS		(FRAME_SIZE / WORD_SIZE)
+#define BADSECTOR		0xFFFFFFFF
+#define DISKPATTERN		0x5A5A0000
 
 #define TERMINATENOGOOD	-1
 
@@ -99,11 +111,28 @@ SEMAPHORE term_mut=1,	/* for mutual exclusion on terminal */
 		endp5=0,		/* to signal demise of p5 */
 		endp8=0,		/* to signal demise of p8 */
 		endcreate=0,	/* for a p8 leaf to signal its creation */
-		blkp8=0;		/* to block p8 */
+		blkp8=0,		/* to block p8 */
+		startp9=0,		/* used by p9 to signal it is about to wait */
+		timedsem=0,		/* p9's timed P, V'ed by p1 */
+		endp9=0,		/* to signal demise of p9 */
+		futexsem=0,		/* p10 blocks on it through the fast path */
+		futexdone=0,	/* p10 wakes p1 up through the fast path */
+		endp11=0,		/* to signal demise of p11 */
+		iosem=0;		/* V'ed on completion of the asynchronous I/O */
 
 state_t p2state, p3state, p4state, p5state,	p6state, p7state;
 state_t p8rootstate, child1state, child2state;
 state_t gchild1state, gchild2state, gchild3state, gchild4state;
+state_t p9state, p10state, p11state;
+
+/* operations batched by p2 (SYS23) */
+sysop_t batch[6];
+
+/* asynchronous I/O control blocks (SYS26) */
+iocb_t	iocb, iocbbusy;
+
+/* blocks written and read by p2 (SYS18 and SYS19) */
+U32		diskbuf[DISKWORDS], diskbuf2[DISKWORDS];
 
 /* trap states for p5 */
 state_t pstat_n, mstat_n, sstat_n, pstat_o,	mstat_o, sstat_o;
@@ -119,7 +148,11 @@ int creation = 0; 				/* return code for SYSCALL invocation */
 memaddr *p5MemLocation = (memaddr *) 0x34;		/* To cause a p5 trap */
 
 void	p2(),p3(),p4(),p5(),p5a(),p5b(),p6(),p7(),p5prog(),p5mm();
-void	p5sys(),p8root(),child1(),child2(),p8leaf();
+void	p5sys(),p8root(),child1(),child2(),p8leaf(),p9(),p10(),p11();
+
+/* semaphore fast path of the nucleus (futex.c) */
+extern void fastPasseren(int *semaddr);
+extern void fastVerhogen(int *semaddr);
 
 /* a procedure to print on terminal 0 */
 void print(char *msg) {
@@ -153,6 +186,90 @@ void print(char *msg) {
 	SYSCALL(VERHOGEN, (int)&term_mut, 0, 0);				/* release term_mut */
 }
 
+/* the same as print, through asynchronous I/O on terminal 0 (SYS26) */
+void asyncPrint(char *msg) {
+
+	char * s = msg;
+	devregtr status;
+
+	SYSCALL(PASSEREN, (int)&term_mut, 0, 0);				/* get term_mut lock */
+
+	iocb.io_line = iocbbusy.io_line = INT_TERMINAL;
+	iocb.io_device = iocbbusy.io_device = 0;
+	iocb.io_transm = iocbbusy.io_transm = TRUE;
+	iocb.io_sem = &iosem;
+
+	while (*s != '\0') {
+		iocb.io_command = PRINTCHR | (((devregtr) *s) << BYTELEN);
+
+		if (SYSCALL(SUBMITIO, (int)&iocb, 0, 0) == SUBMITNOGOOD) {
+			tprint("error: SUBMITIO failed\n");
+			PANIC();
+		}
+
+		/* a second request on the busy transmitter must fail */
+		iocbbusy.io_command = iocb.io_command;
+		if (SYSCALL(SUBMITIO, (int)&iocbbusy, 0, 0) != SUBMITNOGOOD) {
+			tprint("error: SUBMITIO on a busy terminal\n");
+			PANIC();
+		}
+
+		/* Wait I/O completion (the interrupt handler Vs iosem) */
+		SYSCALL(PASSEREN, (int)&iosem, 0, 0);
+		status = iocb.io_status;
+
+		if (!iocb.io_done || (status & TERMSTATMASK) != TRANSM) {
+			tprint("error: SUBMITIO bad status\n");
+			PANIC();
+		}
+
+		if (((status & TERMCHARMASK) >> BYTELEN) != *s) {
+			tprint("error: SUBMITIO bad character\n");
+			PANIC();
+		}
+
+		s++;
+	}
+
+	SYSCALL(VERHOGEN, (int)&term_mut, 0, 0);				/* release term_mut */
+}
+
+/* the same as print, through the terminal driver on terminal 0 (SYS14) */
+void drvPrint(char *msg) {
+
+	char * s = msg;
+	int len = 0;
+
+	while (s[len] != '\0')
+		len++;
+
+	SYSCALL(PASSEREN, (int)&term_mut, 0, 0);				/* get term_mut lock */
+
+	if (SYSCALL(WRITETERMINAL, (int)msg, len - 1, 0) != len - 1) {
+		tprint("error: WRITETERMINAL bad length\n");
+		PANIC();
+	}
+
+	/* the last character goes through SYS26, accepted only once the driver has
+	   released the transmitter: print and asyncPrint cannot overlap the driver */
+	iocb.io_line = INT_TERMINAL;
+	iocb.io_device = 0;
+	iocb.io_transm = TRUE;
+	iocb.io_sem = &iosem;
+	iocb.io_command = PRINTCHR | (((devregtr) s[len - 1]) << BYTELEN);
+
+	while (SYSCALL(SUBMITIO, (int)&iocb, 0, 0) == SUBMITNOGOOD)
+		SYSCALL(WAITCLOCK, 0, 0, 0);
+
+	SYSCALL(PASSEREN, (int)&iosem, 0, 0);
+	if ((iocb.io_status & TERMSTATMASK) != TRANSM) {
+		tprint("error: WRITETERMINAL bad status\n");
+		PANIC();
+	}
+
+	SYSCALL(VERHOGEN, (int)&term_mut, 0, 0);				/* release term_mut */
+}
+
 
 /*                                                                   */
 /*                 p1 -- the root process                            */
@@ -257,6 +374,21 @@ void test() {
 	gchild4state.sp = gchild3state.sp - QPAGE;
 	gchild4state.pc = (memaddr)p8leaf;
 	gchild4state.cpsr = STATUS_ALL_INT_ENABLE(gchild4state.cpsr);
+
+	STST(&p9state);
+	p9state.sp = gchild4state.sp - QPAGE;
+	p9state.pc = (memaddr)p9;
+	p9state.cpsr = STATUS_ALL_INT_ENABLE(p9state.cpsr);
+
+	STST(&p10state);
+	p10state.sp = p9state.sp - QPAGE;
+	p10state.pc = (memaddr)p10;
+	p10state.cpsr = STATUS_ALL_INT_ENABLE(p10state.cpsr) & 0xFFFFFFF0;	/* user mode on */
+
+	STST(&p11state);
+	p11state.sp = p10state.sp - QPAGE;
+	p11state.pc = (memaddr)p11;
+	p11state.cpsr = STATUS_ALL_INT_ENABLE(p11state.cpsr);
 	
 	/* create process p2 */
 	SYSCALL(CREATEPROCESS, (int)&p2state, 0, 0);				/* start p2     */
@@ -279,6 +411,34 @@ void test() {
   /* P1 blocks until p3 ends */
 	SYSCALL(PASSEREN, (int)&endp3, 0, 0);					/* P(endp3)     */
 
+	SYSCALL(CREATEPROCESS, (int)&p9state, 0, 0);		/* start p9     */
+
+	/* let p9 block on its timed P, then V it well before the timeout */
+	SYSCALL(PASSEREN, (int)&startp9, 0, 0);				/* P(startp9)   */
+	SYSCALL(WAITCLOCK, 0, 0, 0);
+	SYSCALL(VERHOGEN, (int)&timedsem, 0, 0);				/* V(timedsem)  */
+
+	SYSCALL(PASSEREN, (int)&endp9, 0, 0);					/* P(endp9)     */
+
+	/* contended fast path P and V in user mode (p10 cannot print) */
+	SYSCALL(CREATEPROCESS, (int)&p10state, 0, 0);		/* start p10    */
+
+	/* let p10 block on futexsem, then wake it up through the fast path */
+	SYSCALL(WAITCLOCK, 0, 0, 0);
+	if (futexsem != -1)
+		print("error: p10 not blocked by a contended fast P\n");
+	fastVerhogen(&futexsem);
+
+	/* p10 Vs futexdone while p1 waits on it: it must not trap */
+	SYSCALL(PASSEREN, (int)&futexdone, 0, 0);				/* P(futexdone) */
+	if (futexsem != 0 || futexdone != 0)
+		print("error: p10 bad fast v/p in user mode\n");
+	else
+		print("p10 contended fast v/p in user mode OK\n");
+
+	/* p11 sleeps while the other tests go on */
+	SYSCALL(CREATEPROCESS, (int)&p11state, 0, 0);		/* start p11    */
+
 
 	SYSCALL(CREATEPROCESS, (int)&p4state, 0, 0);		/* start p4     */
 
@@ -323,6 +483,8 @@ void test() {
 		SYSCALL(VERHOGEN, (int)&blkp8, 0, 0);
 	}
 	
+	SYSCALL(PASSEREN, (int)&endp11, 0, 0);				/* P(endp11)    */
+
 	print("p1 finishes OK -- TTFN\n");
 	* ((memaddr *) BADADDR) = 0;				/* terminate p1 */
 
@@ -337,6 +499,7 @@ void p2() {
 	int		i;				       /* just to waste time  */
 	cpu_t	now1,now2;		   /* times of day        */
 	cpu_t	cpu_t1, cpu_t2;	 /* cpu time used       */
+	diskstat_t	dstat1, dstat2;	/* disk driver counters */
 
   /* startp2 is initialized to 0. p1 Vs it then waits for p2 termination */
 	SYSCALL(PASSEREN, (int)&startp2, 0, 0);				/* P(startp2)   */
@@ -355,6 +518,104 @@ void p2() {
 
 	print("p2 v/p pairs successfully\n");
 
+	/* V, then P, all of the semaphores in the s[] array through the fast path */
+	for (i = 0; i <= MAXSEM; i++)  {
+		fastVerhogen(&s[i]);							/* V(S[I]) */
+		fastPasseren(&s[i]);							/* P(S[I]) */
+		if (s[i] != 0) print("error: p2 bad fast v/p pairs\n");
+	}
+
+	print("p2 fast v/p pairs successfully\n");
+
+	/* test of SYS12 */
+	if (SYSCALL(TRYPASSEREN, (int)&s[0], 0, 0) != PNOGOOD || s[0] != 0)
+		print("error: p2 try P on a busy semaphore\n");
+
+	SYSCALL(VERHOGEN, (int)&s[0], 0, 0);				/* V(S[0]) */
+	if (SYSCALL(TRYPASSEREN, (int)&s[0], 0, 0) == PNOGOOD || s[0] != 0)
+		print("error: p2 try P on a free semaphore\n");
+
+	print("p2 TRYPASSEREN OK\n");
+
+	/* test of SYS22: nobody Vs s[0], so the timeout expires */
+	if (SYSCALL(TIMEDPASSEREN, (int)&s[0], TIMEOUT, 0) != PNOGOOD || s[0] != 0)
+		print("error: p2 timed P did not time out\n");
+	else
+		print("p2 TIMEDPASSEREN OK\n");
+
+	/* test of SYS23: V(s[1]) twice, P(s[1]), GETCPUTIME, then P(s[2]) would block */
+	for (i = 0; i < 6; i++)
+		batch[i].op_arg1 = batch[i].op_result = 0;
+	batch[0].op_num = VERHOGEN;		batch[0].op_arg1 = (int)&s[1];
+	batch[1].op_num = VERHOGEN;		batch[1].op_arg1 = (int)&s[1];
+	batch[2].op_num = PASSEREN;		batch[2].op_arg1 = (int)&s[1];
+	batch[3].op_num = GETCPUTIME;
+	batch[4].op_num = PASSEREN;		batch[4].op_arg1 = (int)&s[2];
+	batch[5].op_num = VERHOGEN;		batch[5].op_arg1 = (int)&s[2];
+
+	if (SYSCALL(SYSCALLBATCH, (int)batch, 6, 0) != 4)
+		print("error: p2 batch did not stop before the blocking P\n");
+	else if (s[1] != 1 || s[2] != 0 || batch[3].op_result == 0)
+		print("error: p2 batch bad results\n");
+	else
+		print("p2 SYSCALLBATCH OK\n");
+
+	SYSCALL(PASSEREN, (int)&s[1], 0, 0);			/* P(S[1]) */
+
+	/* test of SYS26: a request on a nonexistent device fails */
+	iocb.io_line = INT_TERMINAL;
+	iocb.io_device = DEV_PER_INT;
+	if (SYSCALL(SUBMITIO, (int)&iocb, 0, 0) != SUBMITNOGOOD)
+		print("error: p2 SUBMITIO on a nonexistent terminal\n");
+
+	asyncPrint("p2 SUBMITIO OK\n");
+
+	/* test of SYS14: a nonexistent terminal fails */
+	if (SYSCALL(WRITETERMINAL, (int)"x", 1, DEV_PER_INT) != -1)
+		print("error: p2 WRITETERMINAL on a nonexistent terminal\n");
+
+	drvPrint("p2 WRITETERMINAL OK\n");
+
+#if TERM_READ
+	/* test of SYS13: a nonexistent terminal fails */
+	if (SYSCALL(READTERMINAL, (int)diskbuf, FRAME_SIZE, DEV_PER_INT) != -1)
+		print("error: p2 READTERMINAL on a nonexistent terminal\n");
+#endif
+
+	/* test of SYS18 and SYS19: a nonexistent disk or sector fails */
+	if (SYSCALL(DISK_PUT, (int)diskbuf, DEV_PER_INT, 0) != DISKNOGOOD ||
+		SYSCALL(DISK_GET, (int)diskbuf, DEV_PER_INT, 0) != DISKNOGOOD ||
+		SYSCALL(DISK_PUT, (int)diskbuf, 0, BADSECTOR) != DISKNOGOOD ||
+		SYSCALL(DISK_GET, (int)diskbuf, 0, BADSECTOR) != DISKNOGOOD)
+		print("error: p2 disk request on a nonexistent disk or sector\n");
+
+	/* a read from the device is a miss (SYS25), then a written block is read back from the cache */
+	SYSCALL(DISKSTATS, (int)&dstat1, 0, 0);
+	if (SYSCALL(DISK_GET, (int)diskbuf2, 0, 0) == DISKNOGOOD)
+		print("p2 disk 0 not installed: DISK_PUT/DISK_GET skipped\n");
+	else {
+		SYSCALL(DISKSTATS, (int)&dstat2, 0, 0);
+		if (dstat2.ds_misses != dstat1.ds_misses + 1)
+			print("error: p2 DISK_GET not counted as a miss\n");
+
+		for (i = 0; i < DISKWORDS; i++) diskbuf[i] = DISKPATTERN | i;
+		if (SYSCALL(DISK_PUT, (int)diskbuf, 0, 1) != DEV_S_READY)
+			print("error: p2 DISK_PUT failed\n");
+		else if (SYSCALL(DISK_GET, (int)diskbuf2, 0, 1) != DEV_S_READY)
+			print("error: p2 DISK_GET failed\n");
+		else {
+			for (i = 0; i < DISKWORDS && diskbuf2[i] == diskbuf[i]; i++)
+				;
+			SYSCALL(DISKSTATS, (int)&dstat1, 0, 0);
+			if (i < DISKWORDS)
+				print("error: p2 DISK_GET read a different block\n");
+			else if (dstat1.ds_hits != dstat2.ds_hits + 1)
+				print("error: p2 written block not read from the cache\n");
+			else
+				print("p2 DISK_PUT/DISK_GET/DISKSTATS OK\n");
+		}
+	}
+
 	/* test of SYS6 */
 	
 	now1 = getTODLO();                  				/* time of day   */
@@ -590,7 +851,7 @@ void p5a() {
 void p5b() {
 	cpu_t		time1, time2;
 	
-	SYSCALL(13, 0, 0, 0);
+	SYSCALL(20, 0, 0, 0);		/* not handled by the nucleus: passed up */
 	
 	/* the first time through, we are in user mode */
 	/* and the P should generate a program trap */
@@ -627,10 +888,10 @@ void p5b() {
 void p6() {
 	print("p6 starts\n");
 
-	SYSCALL(13, 0, 0, 0);		/* should cause termination because p6 has no 
+	SYSCALL(20, 0, 0, 0);		/* should cause termination because p6 has no 
 			  trap vector */
 
-	print("error: p6 alive after SYS13() with no trap vector\n");
+	print("error: p6 alive after SYS20() with no trap vector\n");
 
 	PANIC();
 }
@@ -707,3 +968,69 @@ void p8leaf() {
 	print("error: p8 grandchild was not killed with father\n");
 	PANIC();
 }
+
+
+/* p9 -- timed P satisfied by a V before its timeout */
+void p9() {
+	SYSCALL(VERHOGEN, (int)&startp9, 0, 0);				/* V(startp9)   */
+
+	if (SYSCALL(TIMEDPASSEREN, (int)&timedsem, LONGTIMEOUT, 0) == PNOGOOD || timedsem != 0)
+		print("error: p9 timed P timed out before the V\n");
+	else
+		print("p9 TIMEDPASSEREN early V OK\n");
+
+	SYSCALL(VERHOGEN, (int)&endp9, 0, 0);					/* V(endp9)     */
+
+	SYSCALL(TERMINATEPROCESS, 0, 0, 0);			/* terminate p9 */
+
+	/* just did a SYS2, so should not get to this point */
+	print("error: p9 didn't terminate\n");
+	PANIC();					/* PANIC! */
+}
+
+
+/* p10 -- contended fast path P and V in user mode */
+void p10() {
+	fastPasseren(&futexsem);				/* blocks: FUTEXWAIT */
+
+	fastVerhogen(&futexdone);				/* p1 waits: FUTEXWAKE */
+
+	/* SYS2 is privileged, so this program trap terminates p10 */
+	SYSCALL(TERMINATEPROCESS, 0, 0, 0);
+}
+
+
+/* p11 -- SYS17 test process: a short sleep, then one cascading through the timing wheel */
+void p11() {
+	cpu_t	time1, time2;
+
+	time1 = getTODLO();
+	SYSCALL(DELAY, SHORTDELAY, 0, 0);
+	time2 = getTODLO();
+
+	if ((time2 - time1) < (SHORTDELAY - 1) * CLOCKINTERVAL)
+		print("error: p11 woken up too early\n");
+	else if ((time2 - time1) > (SHORTDELAY + 1) * CLOCKINTERVAL)
+		print("error: p11 woken up too late\n");
+	else
+		print("p11 - DELAY OK\n");
+
+	time1 = getTODLO();
+	SYSCALL(DELAY, LONGDELAY, 0, 0);
+	time2 = getTODLO();
+
+	if ((time2 - time1) < (LONGDELAY - 1) * CLOCKINTERVAL)
+		print("error: p11 woken up too early after the cascade\n");
+	else if ((time2 - time1) > (LONGDELAY + 1) * CLOCKINTERVAL)
+		print("error: p11 woken up too late after the cascade\n");
+	else
+		print("p11 - DELAY cascade OK\n");
+
+	SYSCALL(VERHOGEN, (int)&endp11, 0, 0);				/* V(endp11)    */
+
+	SYSCALL(TERMINATEPROCESS, 0, 0, 0);			/* terminate p11 */
+
+	/* just did a SYS2, so should not get to this point */
+	print("error: p11 didn't terminate\n");
+	PANIC();					/* PANIC! */
+}
@@ -0,0 +1,259 @@
+/*
+@file sysbench.c
+@note Benchmark of the SYSCALL round trip: it measures the TOD clock ticks taken by
+a non-blocking system call, from the SYSCALL instruction back to the caller.
+Build it with FASTRET=0 and FASTRET=1 (see the Makefile) to compare the full
+scheduler pass with the fast return path: make bench-compare builds both kernels,
+sysbench-fastret0 and sysbench-fastret1, to be run one after the other with the same
+uARM configuration. The uncontended V/P pairs are timed both through SYS3/SYS4 and
+through the semaphore fast path, which should take no trap. The per-system call counters
+of the nucleus (SYS24) are dumped at the end, after a comparison of the state copy routines.
+Results are printed on terminal 0.
+*/
+
+#include "../../include/uARMconst.h"
+#include "../../include/uARMtypes.h"
+#include "../../include/base.h"
+#include "../../include/const.h"
+#include "../../include/libuarm.h"
+
+/* Number of system calls timed for each benchmark (the total is printed, so it stays a power of ten) */
+#define BENCH_ROUNDS 1000
+
+/* Semaphore used by the V benchmark (never contended) */
+int benchsem = 0;
+
+/* Source and destination of the state copy benchmark */
+state_t benchsrc, benchdst;
+
+/* Nucleus state copy routine (ldm/stm block copy) */
+extern void saveCurrentState(state_t *oldState, state_t *newState);
+
+/* Semaphore fast path of the nucleus (futex.c) */
+extern void fastPasseren(int *semaddr);
+extern void fastVerhogen(int *semaddr);
+
+/* Per-system call counters, as dumped by the nucleus */
+struct
+{
+	unsigned int calls;
+	unsigned int ticks;
+} stats[SYSCALL_LAST + 1];
+
+/* Powers of ten, used to print numbers without dividing (libgcc is not linked) */
+unsigned int powers[] = { 1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+
+/**
+@brief Print an unsigned integer in decimal notation on terminal 0.
+@param n Unsigned integer.
+@return Void.
+*/
+void printNumber(unsigned int n)
+{
+	char buffer[11];
+	int i, j = 0;
+
+	for (i = 0; i < 10; i++)
+	{
+		buffer[j] = '0';
+		while (n >= powers[i])
+		{
+			n -= powers[i];
+			buffer[j]++;
+		}
+
+		/* Skip the leading zeros */
+		if (j || buffer[j] != '0' || i == 9) j++;
+	}
+	buffer[j] = '\0';
+
+	tprint(buffer);
+}
+
+/**
+@brief Time BENCH_ROUNDS system calls and print the average round trip.
+@param name Name of the benchmark.
+@param sysNum SYSCALL value.
+@param arg1 First argument of the system call.
+@return Void.
+*/
+void bench(char *name, unsigned int sysNum, unsigned int arg1)
+{
+	unsigned int start, elapsed;
+	int i;
+
+	start = getTODLO();
+	for (i = 0; i < BENCH_ROUNDS; i++) SYSCALL(sysNum, arg1, 0, 0);
+	elapsed = getTODLO() - start;
+
+	tprint(name);
+	tprint(": ");
+	printNumber(elapsed);
+	tprint(" ticks per 1000 calls\n");
+}
+
+/**
+@brief Performs a P operation on a semaphore through SYS4.
+@param semaddr Semaphore address.
+@return Void.
+*/
+void syscallPasseren(int *semaddr)
+{
+	SYSCALL(PASSEREN, (unsigned int) semaddr, 0, 0);
+}
+
+/**
+@brief Performs a V operation on a semaphore through SYS3.
+@param semaddr Semaphore address.
+@return Void.
+*/
+void syscallVerhogen(int *semaddr)
+{
+	SYSCALL(VERHOGEN, (unsigned int) semaddr, 0, 0);
+}
+
+/**
+@brief Count the V and P system calls issued so far (SYS3, SYS4 and the fast path's FUTEXWAKE
+and FUTEXWAIT), through the nucleus counters.
+@return Number of V and P system calls.
+*/
+unsigned int semTraps()
+{
+	SYSCALL(SYSCALLSTATS, (unsigned int) stats, SYSCALL_LAST + 1, 0);
+
+	return stats[VERHOGEN].calls + stats[PASSEREN].calls + stats[FUTEXWAKE].calls + stats[FUTEXWAIT].calls;
+}
+
+/**
+@brief Time BENCH_ROUNDS uncontended V/P pairs and print the total, with the SYS3/SYS4 traps taken.
+@param name Name of the benchmark.
+@param v V operation.
+@param p P operation.
+@return Void.
+*/
+void benchPairs(char *name, void (*v)(int *), void (*p)(int *))
+{
+	unsigned int start, elapsed, traps;
+	int i;
+
+	traps = semTraps();
+	start = getTODLO();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+	{
+		v(&benchsem);
+		p(&benchsem);
+	}
+	elapsed = getTODLO() - start;
+	traps = semTraps() - traps;
+
+	tprint(name);
+	tprint(": ");
+	printNumber(elapsed);
+	tprint(" ticks per 1000 V/P pairs, ");
+	printNumber(traps);
+	tprint(" traps\n");
+}
+
+/**
+@brief Field-by-field state copy, as done by the nucleus before the block copy (reference for the benchmark).
+@param oldState Current state.
+@param newState New state.
+@return Void.
+*/
+void fieldCopy(state_t *oldState, state_t *newState)
+{
+	newState->a1 = oldState->a1;
+	newState->a2 = oldState->a2;
+	newState->a3 = oldState->a3;
+	newState->a4 = oldState->a4;
+	newState->v1 = oldState->v1;
+	newState->v2 = oldState->v2;
+	newState->v3 = oldState->v3;
+	newState->v4 = oldState->v4;
+	newState->v5 = oldState->v5;
+	newState->v6 = oldState->v6;
+	newState->sl = oldState->sl;
+	newState->fp = oldState->fp;
+	newState->ip = oldState->ip;
+	newState->sp = oldState->sp;
+	newState->lr = oldState->lr;
+	newState->pc = oldState->pc;
+	newState->cpsr = oldState->cpsr;
+	newState->CP15_Control = oldState->CP15_Control;
+	newState->CP15_EntryHi = oldState->CP15_EntryHi;
+	newState->CP15_Cause = oldState->CP15_Cause;
+	newState->TOD_Hi = oldState->TOD_Hi;
+	newState->TOD_Low = oldState->TOD_Low;
+}
+
+/**
+@brief Time BENCH_ROUNDS state copies and print the total.
+@param name Name of the benchmark.
+@param copy State copy routine.
+@return Ticks taken by BENCH_ROUNDS copies.
+*/
+unsigned int benchCopy(char *name, void (*copy)(state_t *, state_t *))
+{
+	unsigned int start, elapsed;
+	int i;
+
+	start = getTODLO();
+	for (i = 0; i < BENCH_ROUNDS; i++) copy(&benchsrc, &benchdst);
+	elapsed = getTODLO() - start;
+
+	tprint(name);
+	tprint(": ");
+	printNumber(elapsed);
+	tprint(" ticks per 1000 copies\n");
+
+	return elapsed;
+}
+
+/**
+@brief Benchmark entry point (started by the nucleus as the first process).
+@return Void.
+*/
+void test()
+{
+	unsigned int fieldTicks, blockTicks;
+	int i, n;
+
+	tprint(SYSCALL_FAST_RETURN? "SYSCALL round trip (fast return path)\n" : "SYSCALL round trip (full scheduler pass)\n");
+
+	bench("GETCPUTIME", GETCPUTIME, 0);
+	bench("GETPRIORITY", GETPRIORITY, 0);
+	bench("VERHOGEN", VERHOGEN, (unsigned int) &benchsem);
+	bench("TRYPASSEREN", TRYPASSEREN, (unsigned int) &benchsem);
+
+	/* Compare the V/P system calls with the semaphore fast path */
+	benchPairs("V/P (SYSCALL)", syscallVerhogen, syscallPasseren);
+	benchPairs("V/P (fast path)", fastVerhogen, fastPasseren);
+
+	/* Compare the state copy routines */
+	fieldTicks = benchCopy("State copy (field by field)", fieldCopy);
+	blockTicks = benchCopy("State copy (ldm/stm)", saveCurrentState);
+
+	/* The nucleus copies the state once on every SYSCALL and interrupt entry */
+	tprint("State copy: ldm/stm ");
+	tprint(blockTicks <= fieldTicks? "saves " : "loses ");
+	printNumber(blockTicks <= fieldTicks? fieldTicks - blockTicks : blockTicks - fieldTicks);
+	tprint(" ticks per 1000 copies\n");
+
+	/* Dump the nucleus counters of the system calls issued so far */
+	n = SYSCALL(SYSCALLSTATS, (unsigned int) stats, SYSCALL_LAST + 1, 0);
+	for (i = 0; i < n; i++)
+	{
+		if (!stats[i].calls) continue;
+
+		tprint("SYSCALL ");
+		printNumber(i);
+		tprint(": ");
+		printNumber(stats[i].calls);
+		tprint(" calls, ");
+		printNumber(stats[i].ticks);
+		tprint(" ticks\n");
+	}
+
+	tprint("Done\n");
+	SYSCALL(TERMINATEPROCESS, 0, 0, 0);
+}